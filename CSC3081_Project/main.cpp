@@ -6,15 +6,90 @@
 #include <vector>
 #include <cmath>
 #include <cstdlib>
+#include <cstdio>
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <csignal>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <fstream>
+#include <deque>
+#include <string>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#endif
 #include <GL/glut.h>
 #include <GL/glu.h>
+#ifndef _WIN32
+#include <GL/glx.h>
+#endif
 #include <SOIL2.h>
 
+// SIMD backend for the CPU math (define SCENE_NO_SIMD to force the scalar path)
+#if !defined(SCENE_NO_SIMD) && (defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1))
+#define SCENE_SIMD_SSE 1
+#include <xmmintrin.h>
+#elif !defined(SCENE_NO_SIMD) && (defined(__ARM_NEON) || defined(_M_ARM64))
+#define SCENE_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
 
+// Extension enums (the Windows headers only cover GL 1.1)
+#ifndef GL_FRAMEBUFFER_EXT
+#define GL_FRAMEBUFFER_EXT 0x8D40
+#define GL_RENDERBUFFER_EXT 0x8D41
+#define GL_COLOR_ATTACHMENT0_EXT 0x8CE0
+#define GL_DEPTH_ATTACHMENT_EXT 0x8D00
+#define GL_STENCIL_ATTACHMENT_EXT 0x8D20
+#define GL_FRAMEBUFFER_COMPLETE_EXT 0x8CD5
+#endif
+#ifndef GL_DEPTH24_STENCIL8_EXT
+#define GL_DEPTH24_STENCIL8_EXT 0x88F0
+#endif
+#ifndef GL_CLAMP_TO_EDGE
+#define GL_CLAMP_TO_EDGE 0x812F
+#endif
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER 0x8892
+#define GL_STREAM_DRAW 0x88E0
+#define GL_WRITE_ONLY 0x88B9
+#endif
+#ifndef GL_PIXEL_PACK_BUFFER
+#define GL_PIXEL_PACK_BUFFER 0x88EB
+#define GL_STREAM_READ 0x88E1
+#define GL_READ_ONLY 0x88B8
+#endif
+#ifndef GL_POINT_SPRITE
+#define GL_POINT_SPRITE 0x8861
+#define GL_COORD_REPLACE 0x8862
+#endif
+#ifndef GL_TEXTURE0
+#define GL_TEXTURE0 0x84C0
+#define GL_TEXTURE1 0x84C1
+#endif
+#ifndef GL_POINT_SIZE_MIN
+#define GL_POINT_SIZE_MIN 0x8126
+#define GL_POINT_SIZE_MAX 0x8127
+#define GL_POINT_DISTANCE_ATTENUATION 0x8129
+#endif
+#ifndef GL_TIME_ELAPSED
+#define GL_TIME_ELAPSED 0x88BF
+#endif
+#ifndef GL_QUERY_RESULT
+#define GL_QUERY_RESULT 0x8866
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+
 // Window
 const int WINDOW_WIDTH = 1024;
 const int WINDOW_HEIGHT = 768;
@@ -23,10 +98,20 @@ const int WINDOW_HEIGHT = 768;
 const int TERRAIN_SIZE = 50;
 const float TERRAIN_SCALE = 2.0f;
 const float HEIGHT_SCALE = 3.0f;
+const uint32_t TERRAIN_SEED = 42;
 
 // Animation / scene
 float _angle = 0.0f;
 
+// Light setup shared by setupLighting() and the terrain bake
+const GLfloat SUN_POSITION[] = { 100.0f, 200.0f, 100.0f, 0.0f };
+const GLfloat SUN_AMBIENT[] = { 0.3f, 0.3f, 0.4f, 1.0f };
+const GLfloat SUN_DIFFUSE[] = { 1.0f, 0.95f, 0.8f, 1.0f };
+const GLfloat SUN_SPECULAR[] = { 1.0f, 1.0f, 0.9f, 1.0f };
+const GLfloat FILL_POSITION[] = { -50.0f, 50.0f, 50.0f, 1.0f };
+const GLfloat FILL_DIFFUSE[] = { 0.4f, 0.4f, 0.5f, 1.0f };
+const GLfloat GLOBAL_AMBIENT[] = { 0.2f, 0.2f, 0.3f, 1.0f };
+
 // Camera (from turbine code)
 struct Camera {
     float x = 50.0f, y = 30.0f, z = 80.0f;
@@ -37,14 +122,13 @@ struct Camera {
 } camera;
 
 // Wind turbine variables (from turbine code)
-float windSpeed = 1.0f;
-float bladeRotation = 0.0f;
-float nacelle_yaw = 0.0f;
-float towerSway = 0.0f;
+float windSpeed = 1.0f;   // mean wind speed of the farm; local wind comes from the wind field
 float timeAccumulator = 0.0f;
+int farmSize = 3;         // turbines simulated (--farm N); the first three are the scene turbines
 bool animationEnabled = true;
 bool lightingEnabled = true;
 int projectionMode = 0; // 0 perspective, 1 ortho
+int viewCount = 1;      // main view, then site map, then turbine close-ups
 
 // Textures (single unified set)
 GLuint grassTexture = 0;
@@ -68,6 +152,12 @@ GLuint treeTexture = 0;
 std::vector<std::vector<float>> terrainHeights;
 std::vector<std::vector<int>> terrainTextures;
 
+// Terrain LOD: grid strides (divisors of TERRAIN_SIZE) and the max height error of each
+const int TERRAIN_LOD_STEPS[] = { 1, 2, 5, 10 };
+const int TERRAIN_LOD_LEVELS = 4;
+float terrainLodErrors[TERRAIN_LOD_LEVELS] = { 0.0f };
+int terrainLodStep = 1;
+
 // Turbine parameters
 struct TurbineGeometry {
     float baseRadius = 3.5f;
@@ -82,8 +172,429 @@ struct TurbineGeometry {
     int bladeSegments = 20;
     float foundationRadius = 8.0f;
     float foundationHeight = 2.0f;
+    int nacelleSegments = 20;
+    int ringMajorSegments = 24;
+    int ringMinorSegments = 16;
 } turbineParams;
 
+// Turbine placements (world-space base positions)
+const int TURBINE_COUNT = 3;
+const float turbineSites[TURBINE_COUNT][3] = {
+    { -20.0f, 0.0f, -30.0f },
+    { 30.0f, 0.0f, -25.0f },
+    { -5.0f, 0.0f, -40.0f },
+};
+
+// Wind field: a grid of wind vectors (mean wind + advected turbulence, times Jensen wake
+// deficits behind upstream turbines). Rows are refreshed in slices sized to a per-frame budget.
+struct WindField {
+    int width = 0, height = 0;
+    float cellSize = 45.0f;
+    float originX = 0.0f, originZ = 0.0f;
+    std::vector<float> u, v;                  // per grid point, wind-speed units
+    float time = 0.0f;
+    float meanSpeed = 1.0f;
+    float meanDirection = 0.0f;               // degrees, 0 = blowing toward -X
+    float turbulence = 0.25f;                 // gust strength relative to mean speed
+    float turbulenceScale = 150.0f;           // world units per noise cell
+    float advection = 4.0f;                   // world units per second per wind unit
+    float wakeDecay = 0.075f;                 // Jensen k
+    float thrustCoefficient = 0.8f;
+    float wakeLengthDiameters = 12.0f;
+
+    // Wake footprint index, rebuilt when the mean direction moves
+    std::vector<std::vector<int>> rowWakes;
+    std::vector<float> wakeMinX, wakeMaxX;
+    float wakeDirection = 1e9f;
+
+    // Budgeted refresh
+    float budgetMs = 2.0f;
+    int rowsPerFrame = 0;
+    int nextRow = 0;
+    float fieldMs = 0.0f;                     // wall time of the whole update
+    float kernelMs = 0.0f;                    // longest row chunk: what the budget is charged
+} windField;
+
+// Below this the mast lean is skipped: the sway vector (the lean axis) is ~zero
+const float MIN_LEAN_DEGREES = 1e-3f;
+
+// Per-turbine state in SoA form, driven by wind sampled at each turbine
+struct TurbineFarm {
+    int count = 0;
+    std::vector<float> posX, posZ;
+    std::vector<float> windU, windV;          // sampled local wind
+    std::vector<float> yaw;                   // degrees
+    std::vector<float> rotorAngle, rotorSpeed; // degrees, degrees per second
+    std::vector<float> swayX, swayZ, swayVelX, swayVelZ; // hub displacement, world units
+
+    float rotorGain = 120.0f;                 // rotor degrees per second per wind unit
+    float rotorResponse = 1.5f;               // 1/s
+    float yawRate = 8.0f;                     // degrees per second
+    float swayStiffness = 0.9f;
+    float swayDamping = 0.2f;
+    float swayLoad = 0.12f;
+    float updateMs = 0.0f;
+} turbineFarm;
+
+// CPU math types. Mat4 is column-major, same layout as glLoadMatrixf. Vec3 carries a
+// fourth lane that stays 0, so every type loads as one simd4.
+struct Vec3 {
+    float x, y, z, pad;
+};
+
+struct Vec4 {
+    float x, y, z, w;
+};
+
+struct Quat {
+    float x, y, z, w;
+};
+
+struct Mat4 {
+    float m[16];
+};
+
+// Flat transform hierarchy: parents always precede children, so one forward pass
+// over the arrays produces every world matrix
+struct TransformHierarchy {
+    std::vector<int> parents;
+    std::vector<Mat4> locals;
+    std::vector<Mat4> worlds;
+};
+
+// Baked static terrain lighting: smooth vertex normals, horizon-based ambient occlusion and a
+// sun/fill lightmap. Keyed by a hash of the heights and lights and cached on disk next to the
+// textures, so the runtime only pays a lightmap fetch.
+const char* const TERRAIN_BAKE_CACHE = "terrain_bake.cache";
+const uint32_t TERRAIN_BAKE_VERSION = 2; // 2: normals stored as padded Vec3
+const int LIGHTMAP_SIZE = 256;
+const int LIGHTMAP_TILE = 32;
+
+struct TerrainBake {
+    int lightmapSize = LIGHTMAP_SIZE;
+    std::vector<Vec3> normals;             // (TERRAIN_SIZE + 1)^2, index i * (TERRAIN_SIZE + 1) + j
+    std::vector<float> occlusion;          // same layout, 1 = fully open sky
+    std::vector<unsigned char> lightmap;   // RGB, s along x (i), t along z (j)
+    GLuint lightmapTexture = 0;
+    uint64_t sourceHash = 0;
+    float bakeMs = 0.0f;
+    bool fromCache = false;
+} terrainBake;
+
+// Persistent worker pool for per-frame parallel loops; parallelFor's spawn-per-call threads
+// are kept for one-off work (terrain generation, bakes)
+// One published job; workers copy it under the pool mutex so a later job can't change it mid-run
+struct PoolJob {
+    const std::function<void(int, int)>* fn = nullptr;
+    int first = 0, last = 0, chunk = 1, chunks = 0;
+};
+
+struct WorkerPool {
+    std::vector<std::thread> threads;
+    std::mutex submit;              // one job at a time
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    PoolJob job;
+    std::atomic<int> nextChunk{ 0 };
+    int finishedChunks = 0;
+    int activeWorkers = 0;
+    unsigned generation = 0;
+    bool quit = false;
+} workerPool;
+
+// Render command list: a worker thread walks and culls the scene and records final
+// modelview matrices; the GL thread only replays the list finished the frame before.
+enum RenderCommandType : uint8_t {
+    CMD_SKY, CMD_TERRAIN, CMD_HOUSE, CMD_FOUNDATION, CMD_TOWER, CMD_NACELLE, CMD_HUB, CMD_BLADE, CMD_PARTICLES
+};
+
+struct RenderCommand {
+    Mat4 modelView;
+    float param;
+    RenderCommandType type;
+};
+
+// Everything the recorder reads, copied on the GL thread so the worker never touches live globals
+struct SceneSnapshot {
+    Camera camera;
+    float aspect = 1.0f;
+    int projectionMode = 0;
+    int viewCount = 1;
+    int soloView = -1;          // >= 0: cull and emit for that view only (one independent pass)
+    std::vector<float> turbineX, turbineZ, turbineYaw, turbineRotor, turbineSwayX, turbineSwayZ;
+    TurbineGeometry turbine;
+    std::chrono::steady_clock::time_point captureTime;
+};
+
+// One camera and viewport. The rect is a fraction of the output so it survives render scaling.
+const int MAX_VIEWS = 8;
+
+struct RenderView {
+    float rect[4] = { 0.0f, 0.0f, 1.0f, 1.0f }; // x, y, width, height
+    Mat4 projection;
+    Mat4 view;
+    std::vector<RenderCommand> commands;
+    int culledObjects = 0;
+};
+
+// All views share one traversal; each object is culled against every view and
+// lands in the batch of each view that sees it
+struct RenderCommandList {
+    TransformHierarchy transforms;
+    std::vector<RenderView> views;   // views[0] is the main camera
+    std::chrono::steady_clock::time_point captureTime;
+    int culledObjects = 0;
+    float buildMs = 0.0f;
+};
+
+struct RenderPipeline {
+    bool enabled = true;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    SceneSnapshot pending;
+    bool hasJob = false;
+    bool busy = false;
+    bool quit = false;
+    bool primed = false;        // a finished list is waiting in lists[recordIndex]
+    RenderCommandList lists[2];
+    int recordIndex = 0;
+
+    // Stats (GL thread)
+    float waitMs = 0.0f;
+    float replayMs = 0.0f;
+    float latencyMs = 0.0f;
+    float buildMs = 0.0f;
+    int commandCount = 0;
+    int culledObjects = 0;
+    int viewCount = 0;
+} renderPipeline;
+
+// Particles: structure-of-arrays pools updated in 4-wide SIMD over fixed-size batches.
+// Each batch is emitted around one spatial anchor (cloud bank, terrain tile, blade tip)
+// so batches stay compact enough to depth sort as units.
+const int PARTICLE_BATCH_SIZE = 4096;
+const int CLOUD_BATCHES = 32;
+const int DUST_BATCHES = 16;
+const int VORTEX_BATCHES = TURBINE_COUNT * 3;
+
+enum ParticleKind { PARTICLE_CLOUD, PARTICLE_DUST, PARTICLE_VORTEX };
+
+struct ParticleVertex {
+    float x, y, z;
+    unsigned char r, g, b, a;
+};
+
+struct ParticleLayer {
+    ParticleKind kind = PARTICLE_DUST;
+    uint32_t seed = 0;
+    int batchCount = 0;
+    int activeBatches = 0;
+
+    // SoA storage, batchCount * PARTICLE_BATCH_SIZE entries each
+    std::vector<float> posX, posY, posZ;
+    std::vector<float> velX, velY, velZ;
+    std::vector<float> age, life;
+    std::vector<uint32_t> spawnCount;
+
+    // Behaviour
+    float drag = 1.0f;        // how fast velocity relaxes toward the target (1/s)
+    float windFactor = 1.0f;  // fraction of the wind velocity carried
+    float lift = 0.0f;        // target vertical velocity
+    float pointSize = 4.0f;
+    unsigned char color[3] = { 255, 255, 255 };
+    float alpha = 1.0f;
+    float alphaScale = 1.0f;
+    float driftX = 0.0f, driftZ = 0.0f; // integrated wind offset for cloud anchors
+
+    // Rendering
+    GLuint texture = 0;
+    GLuint vbo = 0;
+    std::vector<ParticleVertex> staging;
+    std::vector<float> batchDepth;
+    std::vector<int> batchOrder;
+};
+
+struct ParticleSystem {
+    bool enabled = true;
+    bool useSimd = true;
+    ParticleLayer layers[3];
+    Vec3 wind = { 0.0f, 0.0f, 0.0f, 0.0f };
+    float updateMs = 0.0f;
+    float uploadMs = 0.0f;
+    int drawnBatches = 0;
+} particleSystem;
+
+// Adaptive quality: measures frame time and walks a single quality factor (0 = min bounds,
+// 1 = max bounds) up or down to hold the target frame budget. Changes need the smoothed
+// frame time to leave a dead band and a settle period to pass, so it does not oscillate.
+struct QualityGovernor {
+    bool enabled = true;
+    float targetFrameMs = 1000.0f / 60.0f;
+    // Ratios apply to the frame's work time (the slower of CPU submission and GPU time), not
+    // the interval between frames, which vsync caps at the refresh period
+    float downgradeRatio = 1.10f;  // degrade above target * ratio
+    float upgradeRatio = 0.75f;    // upgrade below target * ratio
+    int settleFrames = 45;
+    float step = 0.125f;
+
+    // Configured bounds
+    int minTowerSegments = 8, maxTowerSegments = 24;
+    int minBladeSegments = 6, maxBladeSegments = 20;
+    int minNacelleSegments = 8, maxNacelleSegments = 20;
+    int minRingMajor = 8, maxRingMajor = 24;
+    int minRingMinor = 6, maxRingMinor = 16;
+    float minTerrainError = 0.0f, maxTerrainError = 1.5f;
+    float minRenderScale = 0.5f, maxRenderScale = 1.0f;
+    float minParticleFraction = 0.25f, maxParticleFraction = 1.0f;
+
+    // State
+    float quality = 1.0f;
+    float renderScale = 1.0f;
+    float particleFraction = 1.0f;
+    float terrainError = 0.0f;
+    float smoothedFrameMs = 0.0f;  // interval between frames
+    float smoothedWorkMs = 0.0f;   // what the decisions use
+    int framesSinceChange = 0;
+    int lastDecision = 0; // -1 degraded, 0 none, +1 upgraded
+} governor;
+
+// Frame timing and the periodic stats line
+const int GPU_TIMER_RING = 3;
+
+struct FrameStats {
+    std::chrono::steady_clock::time_point lastFrame;
+    std::chrono::steady_clock::time_point workStart;
+    std::chrono::steady_clock::time_point lastReport;
+    bool started = false;
+    int framesSinceReport = 0;
+    float frameMs = 0.0f;
+    float workMs = 0.0f;
+    float cpuMs = 0.0f;               // display() up to the swap, without waiting for the GPU
+    float gpuMs = 0.0f;               // latest timer query result, a frame or two old
+
+    // GL_TIME_ELAPSED queries, read back once available so the CPU never waits on the GPU
+    GLuint gpuQueries[GPU_TIMER_RING] = {};
+    bool gpuPending[GPU_TIMER_RING] = {};
+    int gpuRing = 0;
+    bool gpuTiming = false;           // a query is open for this frame
+} frameStats;
+
+// Offscreen target for reduced internal resolution
+struct RenderTarget {
+    GLuint fbo = 0;
+    GLuint colorTexture = 0;
+    GLuint depthBuffer = 0;
+    int width = 0;
+    int height = 0;
+} sceneTarget, captureTarget;
+
+// Frame capture: glReadPixels into a ring of pixel buffer objects, mapped a ring-length later
+// so the GPU never stalls, then handed to an encoder thread through a bounded pool of frames.
+enum CaptureFormat { CAPTURE_PNG, CAPTURE_Y4M };
+const int CAPTURE_RING_SIZE = 3;
+
+struct CaptureFrame {
+    std::vector<unsigned char> pixels; // RGBA, bottom-up as read from GL
+    int index = 0;
+};
+
+struct FrameCapture {
+    bool active = false;
+    bool startPending = false;        // start on the next frame, once the output size is known
+    bool offscreen = false;           // hidden window, frames rendered into captureTarget
+    CaptureFormat format = CAPTURE_Y4M;
+    std::string path = "flythrough.y4m";
+    int frameLimit = 0;               // stop after this many frames, 0 = until toggled off
+    int width = 0, height = 0;
+
+    GLuint pbos[CAPTURE_RING_SIZE] = {};
+    int slotFrame[CAPTURE_RING_SIZE] = { -1, -1, -1 }; // frame held by each slot, -1 = empty
+    int ringIndex = 0;
+
+    // Encoder thread; the pool bounds how many frames can wait for encoding
+    std::thread encoder;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable released;
+    std::deque<CaptureFrame> queue;
+    std::vector<CaptureFrame> freeFrames;
+    int poolSize = 8;
+    bool quit = false;
+    FILE* stream = nullptr;           // Y4M output
+
+    // Stats
+    int framesRead = 0;
+    int framesEncoded = 0;
+    int framesDropped = 0;            // no free frame when the readback completed
+    int encodeErrors = 0;
+    float readbackMs = 0.0f;
+    float encodeMs = 0.0f;
+} frameCapture;
+
+// Set by SIGINT/SIGTERM; the next update() flushes the capture and exits
+volatile std::sig_atomic_t stopRequested = 0;
+
+// GL extension entry points, resolved at runtime
+typedef void (APIENTRY* GenFramebuffersProc)(GLsizei n, GLuint* ids);
+typedef void (APIENTRY* BindFramebufferProc)(GLenum target, GLuint id);
+typedef void (APIENTRY* GenRenderbuffersProc)(GLsizei n, GLuint* ids);
+typedef void (APIENTRY* BindRenderbufferProc)(GLenum target, GLuint id);
+typedef void (APIENTRY* RenderbufferStorageProc)(GLenum target, GLenum format, GLsizei w, GLsizei h);
+typedef void (APIENTRY* FramebufferTexture2DProc)(GLenum target, GLenum attachment, GLenum texTarget, GLuint tex, GLint level);
+typedef void (APIENTRY* FramebufferRenderbufferProc)(GLenum target, GLenum attachment, GLenum rbTarget, GLuint rb);
+typedef GLenum(APIENTRY* CheckFramebufferStatusProc)(GLenum target);
+typedef void (APIENTRY* GenBuffersProc)(GLsizei n, GLuint* ids);
+typedef void (APIENTRY* BindBufferProc)(GLenum target, GLuint id);
+typedef void (APIENTRY* BufferDataProc)(GLenum target, ptrdiff_t size, const void* data, GLenum usage);
+typedef void (APIENTRY* BufferSubDataProc)(GLenum target, ptrdiff_t offset, ptrdiff_t size, const void* data);
+typedef void* (APIENTRY* MapBufferProc)(GLenum target, GLenum access);
+typedef GLboolean(APIENTRY* UnmapBufferProc)(GLenum target);
+typedef void (APIENTRY* PointParameterfProc)(GLenum pname, GLfloat value);
+typedef void (APIENTRY* PointParameterfvProc)(GLenum pname, const GLfloat* values);
+typedef void (APIENTRY* ActiveTextureProc)(GLenum texture);
+typedef void (APIENTRY* MultiTexCoord2fProc)(GLenum target, GLfloat s, GLfloat t);
+typedef void (APIENTRY* GenQueriesProc)(GLsizei n, GLuint* ids);
+typedef void (APIENTRY* BeginQueryProc)(GLenum target, GLuint id);
+typedef void (APIENTRY* EndQueryProc)(GLenum target);
+typedef void (APIENTRY* GetQueryObjectivProc)(GLuint id, GLenum pname, GLint* value);
+typedef void (APIENTRY* GetQueryObjectui64vProc)(GLuint id, GLenum pname, uint64_t* value);
+
+struct GLExtensions {
+    bool framebufferObjects = false;
+    bool bufferObjects = false;
+    bool pixelBufferObjects = false;
+    bool pointSprites = false;
+    bool pointParameters = false;
+    bool multitexture = false;
+    bool timerQueries = false;
+    GenFramebuffersProc genFramebuffers = nullptr;
+    BindFramebufferProc bindFramebuffer = nullptr;
+    GenRenderbuffersProc genRenderbuffers = nullptr;
+    BindRenderbufferProc bindRenderbuffer = nullptr;
+    RenderbufferStorageProc renderbufferStorage = nullptr;
+    FramebufferTexture2DProc framebufferTexture2D = nullptr;
+    FramebufferRenderbufferProc framebufferRenderbuffer = nullptr;
+    CheckFramebufferStatusProc checkFramebufferStatus = nullptr;
+    GenBuffersProc genBuffers = nullptr;
+    BindBufferProc bindBuffer = nullptr;
+    BufferDataProc bufferData = nullptr;
+    BufferSubDataProc bufferSubData = nullptr;
+    MapBufferProc mapBuffer = nullptr;
+    UnmapBufferProc unmapBuffer = nullptr;
+    PointParameterfProc pointParameterf = nullptr;
+    PointParameterfvProc pointParameterfv = nullptr;
+    ActiveTextureProc activeTexture = nullptr;
+    MultiTexCoord2fProc multiTexCoord2f = nullptr;
+    GenQueriesProc genQueries = nullptr;
+    BeginQueryProc beginQuery = nullptr;
+    EndQueryProc endQuery = nullptr;
+    GetQueryObjectivProc getQueryObjectiv = nullptr;
+    GetQueryObjectui64vProc getQueryObjectui64v = nullptr;
+} glExt;
+
 // Forward declarations
 void init();
 void update();
@@ -95,22 +606,51 @@ void specialKeys(int key, int x, int y);
 
 void generateTerrain();
 void generateMultiTextureTerrain();
+void generateTerrainHeights(std::vector<std::vector<float>>& heights, int size);
+void generateTerrainMaterials(const std::vector<std::vector<float>>& heights,
+    std::vector<std::vector<int>>& materials, int size, uint32_t seed, int threadCount);
+void computeTerrainLodErrors();
+int selectTerrainLodStep(float maxError);
+float sampleTerrainHeight(float x, float z);
 void drawTerrain();
 
+// Terrain lighting bake
+uint64_t hashTerrainBakeInputs(int lightmapSize);
+void bakeTerrainLighting(TerrainBake& bake, int lightmapSize, int threads);
+float horizonOcclusion(float x, float z);
+float sunVisibility(float x, float z);
+Vec3 terrainNormalAt(float x, float z);
+bool loadTerrainBakeCache(TerrainBake& bake, const char* path);
+void saveTerrainBakeCache(const TerrainBake& bake, const char* path);
+void prepareTerrainLighting();
+int runBakeBenchmark(int threads);
+
+// Counter-based RNG & threading helpers
+uint32_t pcgHash(uint32_t v);
+uint32_t counterRandom(uint32_t seed, uint32_t x, uint32_t y, uint32_t stream);
+float counterUnit(uint32_t key, uint32_t stream);
+int workerThreadCount();
+void startWorkerPool();
+void stopWorkerPool();
+void workerPoolLoop();
+void runWorkerPoolChunks(const PoolJob& job);
+void poolParallelFor(int first, int last, int threadCount, const std::function<void(int, int)>& fn);
+int runTerrainBenchmark(int threads);
+
 GLuint loadTexture(const char* filename);
-GLuint createProceduralTexture(int r, int g, int b, int variation);
+GLuint createProceduralTexture(int r, int g, int b, int variation, uint32_t textureId);
 
 void setupLighting();
 void setupProjection();
 
 void drawHouse();
-void drawWindTurbine(); // uses the advanced turbine functions below
+void drawWindTurbine(int index); // uses the advanced turbine functions below
 
 // Advanced turbine functions
 void drawFoundation();
 void drawTurbineTower();
 void drawNacelle();
-void drawRotorSystem();
+void drawRotorSystem(float rotorAngle);
 void drawHub();
 void drawBlade(float angleOffset);
 void drawSolidCylinder(float baseRadius, float topRadius, float height, int segments);
@@ -119,13 +659,162 @@ void drawTorus(float majorRadius, float minorRadius, int majorSegments, int mino
 
 void applyTexture(GLuint textureID);
 void setupMaterials();
+void drawSky();
+
+// Wind field & turbine farm
+void initTurbineFarm(TurbineFarm& farm, int count);
+void initWindField(WindField& field, const TurbineFarm& farm);
+void rebuildWakeRows(WindField& field, const TurbineFarm& farm);
+void updateWindRows(WindField& field, const TurbineFarm& farm, int rowBegin, int rowEnd);
+void updateWindRowsScalar(WindField& field, const TurbineFarm& farm, int rowBegin, int rowEnd);
+void updateWindField(WindField& field, const TurbineFarm& farm, float dt, int threads);
+void sampleWind(const WindField& field, float x, float z, float& u, float& v);
+void updateTurbineRange(TurbineFarm& farm, const WindField& field, int begin, int end, float dt);
+void updateTurbineFarm(TurbineFarm& farm, const WindField& field, float dt, int threads);
+float valueNoise(uint32_t seed, float x, float y);
+float valueNoiseLattice(uint32_t seed, int x, int y);
+float turbineLeanDegrees(float swayX, float swayZ, float height);
+int runWindBenchmark(int threads);
+
+// CPU-side math
+Vec3 vec3Add(const Vec3& a, const Vec3& b);
+Vec3 vec3Sub(const Vec3& a, const Vec3& b);
+Vec3 vec3Scale(const Vec3& v, float s);
+float vec3Dot(const Vec3& a, const Vec3& b);
+Vec3 vec3Cross(const Vec3& a, const Vec3& b);
+Vec3 vec3Normalize(const Vec3& v);
+Vec4 vec4Add(const Vec4& a, const Vec4& b);
+Vec4 vec4Mul(const Vec4& a, const Vec4& b);
+Vec4 vec4Scale(const Vec4& v, float s);
+float vec4Dot(const Vec4& a, const Vec4& b);
+Quat quatFromAxisAngle(float angleDeg, float x, float y, float z);
+Quat quatMultiply(const Quat& a, const Quat& b);
+Quat quatMultiplyScalar(const Quat& a, const Quat& b);
+Mat4 quatToMat4(const Quat& q);
+Mat4 quatToMat4Scalar(const Quat& q);
+Mat4 mat4Identity();
+Mat4 mat4Multiply(const Mat4& a, const Mat4& b);
+Mat4 mat4MultiplyScalar(const Mat4& a, const Mat4& b);
+Vec4 mat4Transform(const Mat4& m, const Vec4& v);
+void mat4TransformBatch(const Mat4& m, const Vec4* in, Vec4* out, size_t count);
+Mat4 mat4FromTranslationRotation(float x, float y, float z, const Quat& rotation);
+Mat4 mat4Translate(float x, float y, float z);
+Mat4 mat4Rotate(float angleDeg, float x, float y, float z);
+Mat4 mat4LookAt(float eyeX, float eyeY, float eyeZ, float centerX, float centerY, float centerZ,
+    float upX, float upY, float upZ);
+Mat4 mat4Perspective(float fovyDeg, float aspect, float zNear, float zFar);
+Mat4 mat4Ortho(float left, float right, float bottom, float top, float zNear, float zFar);
+void extractFrustumPlanes(const Mat4& clip, float planes[6][4]);
+bool sphereInFrustum(const float planes[6][4], float x, float y, float z, float radius);
+int addTransformNode(TransformHierarchy& hierarchy, int parent, const Mat4& local);
+void updateWorldTransforms(TransformHierarchy& hierarchy);
+void updateWorldTransformsScalar(TransformHierarchy& hierarchy);
+int runMathBenchmark();
+
+// Render command list pipeline
+SceneSnapshot captureSceneSnapshot();
+void recordSceneCommands(const SceneSnapshot& snapshot, RenderCommandList& list);
+void layoutViews(int count, float outputAspect, float rects[][4]);
+void replayCommandList(const RenderCommandList& list);
+int runViewBenchmark(int turbines);
+const RenderCommandList& advanceRenderPipeline(const SceneSnapshot& next);
+void renderPipelineWorker();
+void startRenderPipeline();
+void stopRenderPipeline();
+void drainRenderPipeline();
+
+// Particles
+void initParticles();
+void initParticleLayer(ParticleLayer& layer, ParticleKind kind, int batchCount, uint32_t seed);
+void spawnParticle(ParticleLayer& layer, int index);
+void updateParticleRange(ParticleLayer& layer, int begin, int end, float dt, const Vec3& wind);
+void updateParticleRangeScalar(ParticleLayer& layer, int begin, int end, float dt, const Vec3& wind);
+void updateParticleLayer(ParticleLayer& layer, float dt, const Vec3& wind, int threads, bool simd);
+void updateParticles(float dt);
+float buildParticleBatch(const ParticleLayer& layer, int batch, const float* modelView, ParticleVertex* out);
+void drawParticles();
+GLuint createParticleSprite(const char* imageFile);
+Vec3 currentWindVector();
+int runParticleBenchmark(int threads);
+
+// GL extensions & offscreen rendering
+void* getGLProcAddress(const char* name);
+bool hasGLExtension(const char* name);
+bool glVersionAtLeast(int major, int minor);
+void loadGLExtensions();
+bool ensureRenderTarget(RenderTarget& target, int width, int height);
+void drawRenderTarget(const RenderTarget& target);
+
+// Frame capture
+void startFrameCapture(int width, int height);
+void stopFrameCapture();
+void requestStop(int);
+void captureFrame(GLuint fbo, int width, int height);
+bool collectCaptureSlot(int slot, bool wait);
+bool takeCaptureFrame(CaptureFrame& frame, bool wait);
+void captureEncoderWorker();
+void finishCaptureEncoder();
+bool encodeCaptureFrame(const CaptureFrame& frame, std::vector<unsigned char>& scratch);
+void convertFrameToYuv420(const unsigned char* rgba, int width, int height, unsigned char* out);
+
+// Adaptive quality & stats
+void recordFrameTime();
+void finishFrameWork();
+void beginGpuTimer();
+float endGpuTimer();
+void reportFrameWork(float workMs);
+void updateQualityGovernor(float frameMs, float workMs);
+int runGovernorTest();
+void applyQualitySettings();
+void printFrameStats();
 
 int main(int argc, char** argv) {
+    // Offline benchmarks run without creating a window
+    if (argc > 1 && std::strcmp(argv[1], "--bench-terrain") == 0)
+        return runTerrainBenchmark(argc > 2 ? std::atoi(argv[2]) : workerThreadCount());
+    if (argc > 1 && std::strcmp(argv[1], "--bench-math") == 0) return runMathBenchmark();
+    if (argc > 1 && std::strcmp(argv[1], "--test-governor") == 0) return runGovernorTest();
+    if (argc > 1 && std::strcmp(argv[1], "--bench-bake") == 0)
+        return runBakeBenchmark(argc > 2 ? std::atoi(argv[2]) : workerThreadCount());
+    if (argc > 1 && std::strcmp(argv[1], "--bench-views") == 0)
+        return runViewBenchmark(argc > 2 ? std::atoi(argv[2]) : 2000);
+    if (argc > 1 && std::strcmp(argv[1], "--bench-wind") == 0)
+        return runWindBenchmark(argc > 2 ? std::atoi(argv[2]) : workerThreadCount());
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--farm") == 0) farmSize = std::max(TURBINE_COUNT, std::atoi(argv[i + 1]));
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--bench-particles") == 0)
+        return runParticleBenchmark(argc > 2 ? std::atoi(argv[2]) : workerThreadCount());
+
+    // Capture: --capture <file.y4m | prefix for PNGs> [--frames N] [--offscreen]
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            frameCapture.path = argv[i + 1];
+            frameCapture.startPending = true;
+        }
+        if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frameCapture.frameLimit = std::atoi(argv[i + 1]);
+        if (std::strcmp(argv[i], "--offscreen") == 0) frameCapture.offscreen = true;
+    }
+    if (frameCapture.offscreen && !frameCapture.startPending) {
+        std::cerr << "Warning: --offscreen without --capture. Showing the window.\n";
+        frameCapture.offscreen = false;
+    }
+    // a hidden window has no keyboard, so only --frames (or a signal) could end the run
+    if (frameCapture.offscreen && frameCapture.frameLimit <= 0) {
+        std::cerr << "Warning: --offscreen without --frames. Showing the window.\n";
+        frameCapture.offscreen = false;
+    }
+    if (frameCapture.startPending) {
+        std::signal(SIGINT, requestStop);
+        std::signal(SIGTERM, requestStop);
+    }
+
     glutInit(&argc, argv);
     glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH | GLUT_STENCIL);
     glutInitWindowSize(WINDOW_WIDTH, WINDOW_HEIGHT);
     glutInitWindowPosition(50, 50);
     glutCreateWindow("Merged Scene: Terrain, House & Advanced Wind Turbine");
+    if (frameCapture.offscreen) glutHideWindow();
 
     glutDisplayFunc(display);
     glutReshapeFunc(reshape);
@@ -149,6 +838,10 @@ void init() {
 
     generateTerrain();
     generateMultiTextureTerrain();
+    initTurbineFarm(turbineFarm, farmSize);
+    initWindField(windField, turbineFarm);
+    loadGLExtensions();
+    applyQualitySettings();
 
     // Load textures with SOIL2
     barrackTexture = loadTexture("door3.jpg");
@@ -168,45 +861,113 @@ void init() {
 
     setupLighting();
     setupMaterials();
+    prepareTerrainLighting();
+    initParticles();
+    startWorkerPool();
+    startRenderPipeline();
 
-    std::cout << "Merged scene initialized. Controls: WASD QE arrows +/- space L P 1/2 R\n";
+    std::cout << "Merged scene initialized. Controls: WASD QE arrows +/- space L P 1/2 R G M V N\n";
 }
 
 // ---------------------- Update (animation) ----------------------
 void update() {
+    if (stopRequested) {
+        stopFrameCapture();
+        std::exit(0);
+    }
     if (animationEnabled) {
         timeAccumulator += 0.016f; // approx 60fps
 
-        bladeRotation += windSpeed * 2.0f;
-        if (bladeRotation >= 360.0f) bladeRotation -= 360.0f;
+        // mean wind slowly veers; each turbine reacts to its local sample
+        windField.meanSpeed = windSpeed;
+        windField.meanDirection = sin(timeAccumulator * 0.3f) * 15.0f;
+        updateWindField(windField, turbineFarm, 0.016f, workerThreadCount());
+        updateTurbineFarm(turbineFarm, windField, 0.016f, workerThreadCount());
 
-        nacelle_yaw = sin(timeAccumulator * 0.3f) * 15.0f;
-
-        towerSway = sin(timeAccumulator * 0.8f) * 0.5f + cos(timeAccumulator * 0.6f) * 0.3f;
+        updateParticles(0.016f);
     }
 
     // simple global rotation to make scene dynamic
     _angle += 0.02f;
     if (_angle >= 360.0f) _angle -= 360.0f;
 
-    glutPostRedisplay();
+    // a hidden window gets no redisplay events, so offscreen capture renders directly
+    if (frameCapture.offscreen) display();
+    else glutPostRedisplay();
 }
 
 // ---------------------- Display & Render ----------------------
 void display() {
+    recordFrameTime();
+
+    // The final image goes to the window, or to captureTarget when capturing offscreen
+    int windowWidth = glutGet(GLUT_WINDOW_WIDTH);
+    int windowHeight = glutGet(GLUT_WINDOW_HEIGHT);
+    GLuint outputFbo = 0;
+    if (frameCapture.offscreen && ensureRenderTarget(captureTarget, windowWidth, windowHeight)) {
+        outputFbo = captureTarget.fbo;
+    }
+    if (frameCapture.startPending) {
+        frameCapture.startPending = false;
+        startFrameCapture(windowWidth, windowHeight);
+    }
+    // Only the capture can end a hidden window's run: if it failed to start or stopped early
+    // (resize), nothing would ever exit
+    if (frameCapture.offscreen && !frameCapture.active) {
+        std::cerr << "Warning: offscreen capture is not running. Exiting.\n";
+        std::exit(1);
+    }
+
+    // Render at reduced internal resolution when the governor asks for it, then upscale
+    bool scaled = glExt.framebufferObjects && governor.renderScale < 0.999f;
+    if (scaled) {
+        int w = std::max(1, (int)(windowWidth * governor.renderScale));
+        int h = std::max(1, (int)(windowHeight * governor.renderScale));
+        scaled = ensureRenderTarget(sceneTarget, w, h);
+        if (scaled) {
+            glExt.bindFramebuffer(GL_FRAMEBUFFER_EXT, sceneTarget.fbo);
+            glViewport(0, 0, w, h);
+        }
+    }
+    if (!scaled && outputFbo) glExt.bindFramebuffer(GL_FRAMEBUFFER_EXT, outputFbo);
+
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-    setupProjection();
-    setupLighting();
 
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
+    if (renderPipeline.enabled) {
+        // Replay last frame's list while the worker records this frame's
+        const RenderCommandList& list = advanceRenderPipeline(captureSceneSnapshot());
+        auto replayStart = std::chrono::steady_clock::now();
+        replayCommandList(list);
+        auto replayEnd = std::chrono::steady_clock::now();
+        renderPipeline.replayMs = std::chrono::duration<float, std::milli>(replayEnd - replayStart).count();
+        renderPipeline.latencyMs = std::chrono::duration<float, std::milli>(replayEnd - list.captureTime).count();
+    }
+    else {
+        setupProjection();
+        setupLighting();
+
+        glMatrixMode(GL_MODELVIEW);
+        glLoadIdentity();
+
+        // update camera look vector from pitch/yaw in specialKeys
+        gluLookAt(camera.x, camera.y, camera.z,
+            camera.lookX, camera.lookY, camera.lookZ,
+            0.0f, 1.0f, 0.0f);
+
+        renderScene();
+    }
+
+    if (scaled) {
+        glExt.bindFramebuffer(GL_FRAMEBUFFER_EXT, outputFbo);
+        glViewport(0, 0, windowWidth, windowHeight);
+        drawRenderTarget(sceneTarget);
+    }
 
-    // update camera look vector from pitch/yaw in specialKeys
-    gluLookAt(camera.x, camera.y, camera.z,
-        camera.lookX, camera.lookY, camera.lookZ,
-        0.0f, 1.0f, 0.0f);
+    finishFrameWork();
 
-    renderScene();
+    // Readback is queued before the swap; the pixels are collected a few frames later
+    if (frameCapture.active) captureFrame(outputFbo, windowWidth, windowHeight);
+    if (outputFbo) glExt.bindFramebuffer(GL_FRAMEBUFFER_EXT, 0);
 
     glutSwapBuffers();
 }
@@ -217,20 +978,12 @@ void renderScene() {
     glMatrixMode(GL_MODELVIEW);
     glPushMatrix();
     glLoadIdentity();
-    glBegin(GL_QUADS);
-    glColor3f(0.53f, 0.81f, 0.98f);
-    glVertex3f(-1.0f, -1.0f, -0.9f);
-    glVertex3f(1.0f, -1.0f, -0.9f);
-    glVertex3f(1.0f, 1.0f, -0.9f);
-    glVertex3f(-1.0f, 1.0f, -0.9f);
-    glEnd();
+    drawSky();
     glPopMatrix();
     glEnable(GL_DEPTH_TEST);
 
     // Scene transforms
     glPushMatrix();
-    // small sway translation applied to whole base to simulate wind
-    glTranslatef(towerSway, 0.0f, towerSway * 0.3f);
 
     // draw terrain
     drawTerrain();
@@ -241,31 +994,33 @@ void renderScene() {
     drawHouse();
     glPopMatrix();
 
-    // draw one advanced turbine a bit to the back-left
-    glPushMatrix();
-    glTranslatef(-20.0f, 0.0f, -30.0f);
-    // tower built from origin upward; place base at y=0
-    drawWindTurbine();
-    glPopMatrix();
-
-    // second turbine
-    glPushMatrix();
-    glTranslatef(30.0f, 0.0f, -25.0f);
-    drawWindTurbine();
-    glPopMatrix();
+    // turbines; tower built from origin upward, base at y=0
+    for (int t = 0; t < turbineFarm.count; ++t) {
+        glPushMatrix();
+        glTranslatef(turbineFarm.posX[t], 0.0f, turbineFarm.posZ[t]);
+        drawWindTurbine(t);
+        glPopMatrix();
+    }
 
-    // third turbine
-    glPushMatrix();
-    glTranslatef(-5.0f, 0.0f, -40.0f);
-    drawWindTurbine();
     glPopMatrix();
 
-    glPopMatrix();
+    // particles are in world space, drawn last for blending
+    drawParticles();
 
     // reset color
     glColor3f(1, 1, 1);
 }
 
+void drawSky() {
+    glBegin(GL_QUADS);
+    glColor3f(0.53f, 0.81f, 0.98f);
+    glVertex3f(-1.0f, -1.0f, -0.9f);
+    glVertex3f(1.0f, -1.0f, -0.9f);
+    glVertex3f(1.0f, 1.0f, -0.9f);
+    glVertex3f(-1.0f, 1.0f, -0.9f);
+    glEnd();
+}
+
 // ---------------------- Projection & Resize ----------------------
 void setupProjection() {
     glMatrixMode(GL_PROJECTION);
@@ -292,6 +1047,7 @@ void reshape(int w, int h) {
 void keyboardHandler(unsigned char key, int x, int y) {
     switch (key) {
     case 27:  // ESC
+        stopFrameCapture();
         std::exit(0);
         break;
     case 'w': case 'W':
@@ -343,6 +1099,29 @@ void keyboardHandler(unsigned char key, int x, int y) {
         camera.lookX = 0.0f; camera.lookY = 20.0f; camera.lookZ = 0.0f;
         camera.zoom = 45.0f;
         break;
+    case 'g': case 'G':
+        governor.enabled = !governor.enabled;
+        if (!governor.enabled) {
+            governor.quality = 1.0f;
+            governor.lastDecision = 0;
+            applyQualitySettings();
+        }
+        std::cout << "Quality governor " << (governor.enabled ? "on" : "off") << "\n";
+        break;
+    case 'm': case 'M':
+        drainRenderPipeline();
+        renderPipeline.enabled = !renderPipeline.enabled;
+        std::cout << "Render command pipeline " << (renderPipeline.enabled ? "on" : "off") << "\n";
+        break;
+    case 'v': case 'V':
+        if (frameCapture.active) stopFrameCapture();
+        else frameCapture.startPending = true;
+        break;
+    case 'n': case 'N':
+        viewCount = viewCount == 1 ? 4 : viewCount == 4 ? MAX_VIEWS : 1;
+        std::cout << "Views " << viewCount
+            << (renderPipeline.enabled || viewCount == 1 ? "\n" : " (main view only without the command pipeline)\n");
+        break;
     }
 }
 
@@ -360,65 +1139,531 @@ void specialKeys(int key, int x, int y) {
     camera.lookZ = camera.z + cosf(pitchRad) * cosf(yawRad) * 50.0f;
 }
 
+// ---------------------- Counter-based RNG & threading helpers ----------------------
+// Stateless PCG-style hash: every random value is a pure function of (seed, x, y, stream),
+// so any cell or tile can be generated on any thread, in any order, with identical output.
+uint32_t pcgHash(uint32_t v) {
+    uint32_t state = v * 747796405u + 2891336453u;
+    uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+uint32_t counterRandom(uint32_t seed, uint32_t x, uint32_t y, uint32_t stream) {
+    return pcgHash(x ^ pcgHash(y ^ pcgHash(stream ^ pcgHash(seed))));
+}
+
+// Uniform float in [0, 1) from a per-item key
+float counterUnit(uint32_t key, uint32_t stream) {
+    return (pcgHash(key ^ (stream * 0x9E3779B9u)) >> 8) * (1.0f / 16777216.0f);
+}
+
+int workerThreadCount() {
+    unsigned int n = std::thread::hardware_concurrency();
+    return n == 0 ? 1 : (int)n;
+}
+
+// Runs fn(begin, end) over [first, last) split into contiguous row blocks, one per thread
+template <typename Fn>
+void parallelFor(int first, int last, int threadCount, Fn fn) {
+    int count = last - first;
+    if (count <= 0) return;
+    threadCount = std::max(1, std::min(threadCount, count));
+    if (threadCount == 1) {
+        fn(first, last);
+        return;
+    }
+    std::vector<std::thread> workers;
+    workers.reserve(threadCount - 1);
+    int chunk = (count + threadCount - 1) / threadCount;
+    for (int t = 1; t < threadCount; ++t) {
+        int begin = first + t * chunk;
+        int end = std::min(last, begin + chunk);
+        if (begin >= end) break;
+        workers.emplace_back(fn, begin, end);
+    }
+    fn(first, std::min(last, first + chunk));
+    for (std::thread& w : workers) w.join();
+}
+
+// Pool threads live for the whole run (hardware threads - 1; the caller takes chunks too)
+thread_local bool onPoolThread = false;
+
+void startWorkerPool() {
+    if (!workerPool.threads.empty()) return;
+    for (int t = 1; t < workerThreadCount(); ++t) workerPool.threads.emplace_back(workerPoolLoop);
+    std::atexit(stopWorkerPool);
+}
+
+void stopWorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(workerPool.mutex);
+        workerPool.quit = true;
+    }
+    workerPool.wake.notify_all();
+    for (std::thread& t : workerPool.threads) {
+        if (t.joinable()) t.join();
+    }
+    workerPool.threads.clear();
+}
+
+void workerPoolLoop() {
+    onPoolThread = true;
+    unsigned seen = 0;
+    for (;;) {
+        std::unique_lock<std::mutex> lock(workerPool.mutex);
+        workerPool.wake.wait(lock, [&seen] { return workerPool.quit || workerPool.generation != seen; });
+        if (workerPool.quit) return;
+        seen = workerPool.generation;
+        PoolJob job = workerPool.job;
+        workerPool.activeWorkers++;
+        lock.unlock();
+
+        runWorkerPoolChunks(job);
+
+        lock.lock();
+        if (--workerPool.activeWorkers == 0) workerPool.done.notify_all();
+    }
+}
+
+// Takes chunks of the job until none are left. A worker that wakes after the caller has
+// returned finds every chunk claimed; nextChunk can't be reset while it is active.
+void runWorkerPoolChunks(const PoolJob& job) {
+    for (;;) {
+        int c = workerPool.nextChunk.fetch_add(1);
+        if (c >= job.chunks) return;
+        int begin = job.first + c * job.chunk;
+        (*job.fn)(begin, std::min(job.last, begin + job.chunk));
+        std::lock_guard<std::mutex> lock(workerPool.mutex);
+        if (++workerPool.finishedChunks >= job.chunks) workerPool.done.notify_all();
+    }
+}
+
+// Same contract as parallelFor, but wakes the pool instead of creating threads. Returns once
+// every chunk is done and no worker is still inside the job.
+void poolParallelFor(int first, int last, int threadCount, const std::function<void(int, int)>& fn) {
+    int count = last - first;
+    if (count <= 0) return;
+    threadCount = std::max(1, std::min(threadCount, count));
+    if (threadCount == 1 || onPoolThread) {
+        fn(first, last);
+        return;
+    }
+    startWorkerPool();
+    if (workerPool.threads.empty()) {
+        fn(first, last);
+        return;
+    }
+
+    std::lock_guard<std::mutex> submit(workerPool.submit);
+    PoolJob job;
+    job.fn = &fn;
+    job.first = first;
+    job.last = last;
+    job.chunk = (count + threadCount - 1) / threadCount;
+    job.chunks = (count + job.chunk - 1) / job.chunk;
+    {
+        // a worker that woke late for the previous job may still be checking nextChunk
+        std::unique_lock<std::mutex> lock(workerPool.mutex);
+        workerPool.done.wait(lock, [] { return workerPool.activeWorkers == 0; });
+        workerPool.job = job;
+        workerPool.finishedChunks = 0;
+        workerPool.nextChunk = 0;
+        workerPool.generation++;
+    }
+    workerPool.wake.notify_all();
+    runWorkerPoolChunks(job);
+
+    std::unique_lock<std::mutex> lock(workerPool.mutex);
+    workerPool.done.wait(lock, [&job] {
+        return workerPool.finishedChunks >= job.chunks && workerPool.activeWorkers == 0;
+    });
+    workerPool.job.fn = nullptr;
+}
+
 // ---------------------- Terrain generation & drawing ----------------------
 void generateTerrain() {
-    terrainHeights.resize(TERRAIN_SIZE + 1);
-    for (int i = 0; i <= TERRAIN_SIZE; ++i) {
-        terrainHeights[i].resize(TERRAIN_SIZE + 1);
-        for (int j = 0; j <= TERRAIN_SIZE; ++j) {
+    generateTerrainHeights(terrainHeights, TERRAIN_SIZE);
+    computeTerrainLodErrors();
+}
+
+void generateMultiTextureTerrain() {
+    generateTerrainMaterials(terrainHeights, terrainTextures, TERRAIN_SIZE, TERRAIN_SEED, workerThreadCount());
+}
+
+void generateTerrainHeights(std::vector<std::vector<float>>& heights, int size) {
+    heights.resize(size + 1);
+    for (int i = 0; i <= size; ++i) {
+        heights[i].resize(size + 1);
+        for (int j = 0; j <= size; ++j) {
             float h = sin(i * 0.3f) * cos(j * 0.3f) * HEIGHT_SCALE;
             h += sin(i * 0.1f) * sin(j * 0.15f) * HEIGHT_SCALE * 2.0f;
             h += sin(i * 0.05f) * cos(j * 0.08f) * HEIGHT_SCALE * 0.5f;
-            terrainHeights[i][j] = h;
+            heights[i][j] = h;
         }
     }
 }
 
-void generateMultiTextureTerrain() {
-    terrainTextures.resize(TERRAIN_SIZE + 1);
-    srand(42);
-    for (int i = 0; i <= TERRAIN_SIZE; ++i) {
-        terrainTextures[i].resize(TERRAIN_SIZE + 1);
-        for (int j = 0; j <= TERRAIN_SIZE; ++j) {
-            float height = terrainHeights[i][j];
-            float rf = (rand() % 100) / 100.0f;
-            if (height < -2.0f) terrainTextures[i][j] = (rf > 0.7f) ? 3 : 2;
-            else if (height < 2.0f) terrainTextures[i][j] = (rf > 0.6f) ? 3 : 0;
-            else if (height < 5.0f) terrainTextures[i][j] = (rf > 0.5f) ? 1 : 0;
-            else terrainTextures[i][j] = 1;
-            if (rf > 0.95f) terrainTextures[i][j] = rand() % 4;
+// Material index (0-3) per cell. Each cell draws from its own
+// counter (stream 0 for the blend roll, stream 1 for the rare random override).
+void generateTerrainMaterials(const std::vector<std::vector<float>>& heights,
+    std::vector<std::vector<int>>& materials, int size, uint32_t seed, int threadCount) {
+    materials.resize(size + 1);
+    for (int i = 0; i <= size; ++i) materials[i].resize(size + 1);
+
+    parallelFor(0, size + 1, threadCount, [&](int rowBegin, int rowEnd) {
+        for (int i = rowBegin; i < rowEnd; ++i) {
+            for (int j = 0; j <= size; ++j) {
+                float height = heights[i][j];
+                float rf = (counterRandom(seed, i, j, 0) % 100) / 100.0f;
+                int material;
+                if (height < -2.0f) material = (rf > 0.7f) ? 3 : 2;
+                else if (height < 2.0f) material = (rf > 0.6f) ? 3 : 0;
+                else if (height < 5.0f) material = (rf > 0.5f) ? 1 : 0;
+                else material = 1;
+                if (rf > 0.95f) material = counterRandom(seed, i, j, 1) % 4;
+                materials[i][j] = material;
+            }
+        }
+    });
+}
+
+// Single- vs multi-threaded material generation at large sizes; checks outputs match
+int runTerrainBenchmark(int threads) {
+    const int sizes[] = { 512, 1024, 2048, 4096 };
+    threads = std::max(1, threads);
+    std::cout << "Terrain material benchmark (" << threads << " threads)\n";
+    for (int size : sizes) {
+        std::vector<std::vector<float>> heights;
+        generateTerrainHeights(heights, size);
+        std::vector<std::vector<int>> single, multi;
+
+        auto t0 = std::chrono::steady_clock::now();
+        generateTerrainMaterials(heights, single, size, TERRAIN_SEED, 1);
+        auto t1 = std::chrono::steady_clock::now();
+        generateTerrainMaterials(heights, multi, size, TERRAIN_SEED, threads);
+        auto t2 = std::chrono::steady_clock::now();
+
+        double singleMs = std::chrono::duration<double, std::milli>(t1 - t0).count();
+        double multiMs = std::chrono::duration<double, std::milli>(t2 - t1).count();
+        bool identical = (single == multi);
+        std::cout << "  " << size << "x" << size
+            << "  1 thread: " << singleMs << " ms"
+            << "  " << threads << " threads: " << multiMs << " ms"
+            << "  speedup: " << (multiMs > 0.0 ? singleMs / multiMs : 0.0) << "x"
+            << "  identical: " << (identical ? "yes" : "NO") << "\n";
+        if (!identical) return 1;
+    }
+    return 0;
+}
+
+// Max vertical error of each LOD stride: how far skipped vertices sit from the
+// bilinear surface of the coarse quad that replaces them
+void computeTerrainLodErrors() {
+    for (int level = 0; level < TERRAIN_LOD_LEVELS; ++level) {
+        int step = TERRAIN_LOD_STEPS[level];
+        float maxError = 0.0f;
+        for (int i = 0; i < TERRAIN_SIZE; i += step) {
+            for (int j = 0; j < TERRAIN_SIZE; j += step) {
+                float h00 = terrainHeights[i][j];
+                float h10 = terrainHeights[i + step][j];
+                float h11 = terrainHeights[i + step][j + step];
+                float h01 = terrainHeights[i][j + step];
+                for (int di = 0; di <= step; ++di) {
+                    for (int dj = 0; dj <= step; ++dj) {
+                        float u = (float)di / step;
+                        float v = (float)dj / step;
+                        float approx = (h00 * (1 - u) + h10 * u) * (1 - v) + (h01 * (1 - u) + h11 * u) * v;
+                        maxError = std::max(maxError, fabsf(terrainHeights[i + di][j + dj] - approx));
+                    }
+                }
+            }
         }
+        terrainLodErrors[level] = maxError;
     }
 }
 
+// Coarsest stride whose error stays within maxError
+int selectTerrainLodStep(float maxError) {
+    int step = TERRAIN_LOD_STEPS[0];
+    for (int level = 1; level < TERRAIN_LOD_LEVELS; ++level) {
+        if (terrainLodErrors[level] <= maxError) step = TERRAIN_LOD_STEPS[level];
+    }
+    return step;
+}
+
+// Bilinear height at a world-space position, clamped to the grid
+float sampleTerrainHeight(float x, float z) {
+    float gi = x / TERRAIN_SCALE + TERRAIN_SIZE / 2;
+    float gj = z / TERRAIN_SCALE + TERRAIN_SIZE / 2;
+    gi = std::max(0.0f, std::min((float)TERRAIN_SIZE - 0.001f, gi));
+    gj = std::max(0.0f, std::min((float)TERRAIN_SIZE - 0.001f, gj));
+    int i = (int)gi, j = (int)gj;
+    float u = gi - i, v = gj - j;
+    return (terrainHeights[i][j] * (1 - u) + terrainHeights[i + 1][j] * u) * (1 - v) +
+        (terrainHeights[i][j + 1] * (1 - u) + terrainHeights[i + 1][j + 1] * u) * v;
+}
+
 void drawTerrain() {
+    const int step = terrainLodStep;
+    const int stride = TERRAIN_SIZE + 1;
+    const bool baked = !terrainBake.normals.empty();
+
+    // Baked lightmap replaces per-vertex lighting: one extra texture fetch on unit 1
+    const bool lightmapped = lightingEnabled && baked && terrainBake.lightmapTexture != 0 && glExt.multitexture;
+    if (lightmapped) {
+        glPushAttrib(GL_ENABLE_BIT | GL_TEXTURE_BIT);
+        glDisable(GL_LIGHTING);
+        glExt.activeTexture(GL_TEXTURE1);
+        glEnable(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, terrainBake.lightmapTexture);
+        glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+        glExt.activeTexture(GL_TEXTURE0);
+        glColor3f(1, 1, 1);
+    }
+
+    // Emits one vertex with its baked normal (or AO tint when lit per vertex without a lightmap)
+    auto vertex = [&](int i, int j, float s, float t) {
+        if (baked) {
+            const Vec3& n = terrainBake.normals[i * stride + j];
+            glNormal3f(n.x, n.y, n.z);
+            if (!lightmapped) {
+                float ao = terrainBake.occlusion[i * stride + j];
+                glColor3f(ao, ao, ao);
+            }
+        }
+        glTexCoord2f(s, t);
+        if (lightmapped) glExt.multiTexCoord2f(GL_TEXTURE1, (float)i / TERRAIN_SIZE, (float)j / TERRAIN_SIZE);
+        glVertex3f((i - TERRAIN_SIZE / 2) * TERRAIN_SCALE, terrainHeights[i][j], (j - TERRAIN_SIZE / 2) * TERRAIN_SCALE);
+    };
+
     glEnable(GL_TEXTURE_2D);
-    for (int i = 0; i < TERRAIN_SIZE; ++i) {
-        for (int j = 0; j < TERRAIN_SIZE; ++j) {
+    for (int i = 0; i < TERRAIN_SIZE; i += step) {
+        for (int j = 0; j < TERRAIN_SIZE; j += step) {
             int texType = terrainTextures[i][j];
             switch (texType) {
             case 0: glBindTexture(GL_TEXTURE_2D, grassTexture); break;
             default: glBindTexture(GL_TEXTURE_2D, sandTexture); break;
             }
-            float x1 = (i - TERRAIN_SIZE / 2) * TERRAIN_SCALE;
-            float x2 = ((i + 1) - TERRAIN_SIZE / 2) * TERRAIN_SCALE;
-            float z1 = (j - TERRAIN_SIZE / 2) * TERRAIN_SCALE;
-            float z2 = ((j + 1) - TERRAIN_SIZE / 2) * TERRAIN_SCALE;
-            float y1 = terrainHeights[i][j];
-            float y2 = terrainHeights[i + 1][j];
-            float y3 = terrainHeights[i + 1][j + 1];
-            float y4 = terrainHeights[i][j + 1];
+            float t = (float)step; // keep texel density when quads grow
 
             glBegin(GL_QUADS);
-            glNormal3f(0, 1, 0);
-            glTexCoord2f(0, 0); glVertex3f(x1, y1, z1);
-            glTexCoord2f(1, 0); glVertex3f(x2, y2, z1);
-            glTexCoord2f(1, 1); glVertex3f(x2, y3, z2);
-            glTexCoord2f(0, 1); glVertex3f(x1, y4, z2);
+            if (!baked) glNormal3f(0, 1, 0);
+            vertex(i, j, 0, 0);
+            vertex(i + step, j, t, 0);
+            vertex(i + step, j + step, t, t);
+            vertex(i, j + step, 0, t);
             glEnd();
         }
     }
     glDisable(GL_TEXTURE_2D);
+
+    if (lightmapped) glPopAttrib();
+    else if (baked) glColor3f(1, 1, 1);
+}
+
+// ---------------------- Terrain lighting bake ----------------------
+// FNV-1a over everything the bake depends on
+uint64_t hashTerrainBakeInputs(int lightmapSize) {
+    uint64_t hash = 1469598103934665603ull;
+    auto mix = [&hash](const void* data, size_t bytes) {
+        const unsigned char* p = (const unsigned char*)data;
+        for (size_t i = 0; i < bytes; ++i) hash = (hash ^ p[i]) * 1099511628211ull;
+    };
+    mix(&TERRAIN_BAKE_VERSION, sizeof(TERRAIN_BAKE_VERSION));
+    mix(&TERRAIN_SIZE, sizeof(TERRAIN_SIZE));
+    mix(&TERRAIN_SCALE, sizeof(TERRAIN_SCALE));
+    mix(&lightmapSize, sizeof(lightmapSize));
+    for (const std::vector<float>& row : terrainHeights) mix(row.data(), row.size() * sizeof(float));
+    mix(SUN_POSITION, sizeof(SUN_POSITION)); mix(SUN_AMBIENT, sizeof(SUN_AMBIENT));
+    mix(SUN_DIFFUSE, sizeof(SUN_DIFFUSE)); mix(FILL_POSITION, sizeof(FILL_POSITION));
+    mix(FILL_DIFFUSE, sizeof(FILL_DIFFUSE)); mix(GLOBAL_AMBIENT, sizeof(GLOBAL_AMBIENT));
+    return hash;
+}
+
+// Central-difference normal of the bilinear height field
+Vec3 terrainNormalAt(float x, float z) {
+    const float d = TERRAIN_SCALE * 0.5f;
+    float dx = sampleTerrainHeight(x + d, z) - sampleTerrainHeight(x - d, z);
+    float dz = sampleTerrainHeight(x, z + d) - sampleTerrainHeight(x, z - d);
+    return vec3Normalize(Vec3{ -dx, 2.0f * d, -dz, 0.0f });
+}
+
+// Horizon-based AO: march 8 azimuths, keep the highest elevation angle seen in each,
+// and return the fraction of sky left open
+float horizonOcclusion(float x, float z) {
+    const int directions = 8;
+    const int steps = 12;
+    const float stepLength = TERRAIN_SCALE * 0.75f;
+    const float h0 = sampleTerrainHeight(x, z) + 0.05f;
+    float occluded = 0.0f;
+    for (int d = 0; d < directions; ++d) {
+        float angle = d * 2.0f * (float)M_PI / directions;
+        float dirX = cosf(angle), dirZ = sinf(angle);
+        float maxSin = 0.0f;
+        for (int s = 1; s <= steps; ++s) {
+            float dist = s * stepLength;
+            float rise = sampleTerrainHeight(x + dirX * dist, z + dirZ * dist) - h0;
+            if (rise > 0.0f) maxSin = std::max(maxSin, rise / sqrtf(rise * rise + dist * dist));
+        }
+        occluded += maxSin;
+    }
+    return 1.0f - occluded / directions;
+}
+
+// Hard shadow from the directional sun: march toward it until the ray clears the terrain
+float sunVisibility(float x, float z) {
+    Vec3 sun = vec3Normalize(Vec3{ SUN_POSITION[0], SUN_POSITION[1], SUN_POSITION[2], 0.0f });
+    float horizontal = sqrtf(sun.x * sun.x + sun.z * sun.z);
+    if (horizontal < 1e-4f) return 1.0f;
+    float rise = sun.y / horizontal;
+    float dirX = sun.x / horizontal, dirZ = sun.z / horizontal;
+    float h0 = sampleTerrainHeight(x, z) + 0.1f;
+    const float extent = TERRAIN_SIZE * TERRAIN_SCALE;
+    for (float dist = TERRAIN_SCALE * 0.5f; dist < extent; dist += TERRAIN_SCALE * 0.5f) {
+        float rayHeight = h0 + dist * rise;
+        if (rayHeight > HEIGHT_SCALE * 4.0f) break; // above any possible terrain
+        if (sampleTerrainHeight(x + dirX * dist, z + dirZ * dist) > rayHeight) return 0.0f;
+    }
+    return 1.0f;
+}
+
+// Vertex normals and AO by rows, then the lightmap by independent tiles, all on worker threads.
+// The lightmap evaluates the same fixed-function terms setupLighting() configures.
+void bakeTerrainLighting(TerrainBake& bake, int lightmapSize, int threads) {
+    auto start = std::chrono::steady_clock::now();
+    const int stride = TERRAIN_SIZE + 1;
+    const float origin = -(TERRAIN_SIZE / 2) * TERRAIN_SCALE;
+    bake.lightmapSize = lightmapSize;
+    bake.normals.resize(stride * stride);
+    bake.occlusion.resize(stride * stride);
+    bake.lightmap.resize((size_t)lightmapSize * lightmapSize * 3);
+
+    parallelFor(0, stride, threads, [&](int rowBegin, int rowEnd) {
+        for (int i = rowBegin; i < rowEnd; ++i) {
+            for (int j = 0; j < stride; ++j) {
+                float x = origin + i * TERRAIN_SCALE, z = origin + j * TERRAIN_SCALE;
+                bake.normals[i * stride + j] = terrainNormalAt(x, z);
+                bake.occlusion[i * stride + j] = horizonOcclusion(x, z);
+            }
+        }
+    });
+
+    const Vec3 sunDir = vec3Normalize(Vec3{ SUN_POSITION[0], SUN_POSITION[1], SUN_POSITION[2], 0.0f });
+    const int tilesPerSide = (lightmapSize + LIGHTMAP_TILE - 1) / LIGHTMAP_TILE;
+    const float texelSize = TERRAIN_SIZE * TERRAIN_SCALE / lightmapSize;
+    parallelFor(0, tilesPerSide * tilesPerSide, threads, [&](int tileBegin, int tileEnd) {
+        for (int tile = tileBegin; tile < tileEnd; ++tile) {
+            int s0 = (tile % tilesPerSide) * LIGHTMAP_TILE, t0 = (tile / tilesPerSide) * LIGHTMAP_TILE;
+            for (int t = t0; t < std::min(lightmapSize, t0 + LIGHTMAP_TILE); ++t) {
+                for (int s = s0; s < std::min(lightmapSize, s0 + LIGHTMAP_TILE); ++s) {
+                    float x = origin + (s + 0.5f) * texelSize;
+                    float z = origin + (t + 0.5f) * texelSize;
+                    Vec3 n = terrainNormalAt(x, z);
+                    float ao = horizonOcclusion(x, z);
+                    float sun = std::max(0.0f, vec3Dot(n, sunDir)) * sunVisibility(x, z);
+                    Vec3 toFill = vec3Normalize(Vec3{ FILL_POSITION[0] - x, FILL_POSITION[1] - sampleTerrainHeight(x, z),
+                        FILL_POSITION[2] - z, 0.0f });
+                    float fill = std::max(0.0f, vec3Dot(n, toFill));
+
+                    unsigned char* texel = &bake.lightmap[((size_t)t * lightmapSize + s) * 3];
+                    for (int c = 0; c < 3; ++c) {
+                        float light = (GLOBAL_AMBIENT[c] + SUN_AMBIENT[c]) * ao + SUN_DIFFUSE[c] * sun + FILL_DIFFUSE[c] * fill;
+                        texel[c] = (unsigned char)(std::min(1.0f, light) * 255.0f + 0.5f);
+                    }
+                }
+            }
+        }
+    });
+
+    bake.bakeMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool loadTerrainBakeCache(TerrainBake& bake, const char* path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    uint64_t hash = 0;
+    int32_t size = 0;
+    in.read((char*)&hash, sizeof(hash));
+    in.read((char*)&size, sizeof(size));
+    if (!in || hash != bake.sourceHash || size != bake.lightmapSize) return false;
+
+    const int stride = TERRAIN_SIZE + 1;
+    bake.normals.resize(stride * stride);
+    bake.occlusion.resize(stride * stride);
+    bake.lightmap.resize((size_t)size * size * 3);
+    in.read((char*)bake.normals.data(), bake.normals.size() * sizeof(Vec3));
+    in.read((char*)bake.occlusion.data(), bake.occlusion.size() * sizeof(float));
+    in.read((char*)bake.lightmap.data(), bake.lightmap.size());
+    if (!in) {
+        bake.normals.clear();
+        return false;
+    }
+    return true;
+}
+
+void saveTerrainBakeCache(const TerrainBake& bake, const char* path) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        std::cerr << "Warning: could not write terrain bake cache '" << path << "'.\n";
+        return;
+    }
+    int32_t size = bake.lightmapSize;
+    out.write((const char*)&bake.sourceHash, sizeof(bake.sourceHash));
+    out.write((const char*)&size, sizeof(size));
+    out.write((const char*)bake.normals.data(), bake.normals.size() * sizeof(Vec3));
+    out.write((const char*)bake.occlusion.data(), bake.occlusion.size() * sizeof(float));
+    out.write((const char*)bake.lightmap.data(), bake.lightmap.size());
+}
+
+// Loads the cached bake when the terrain and lights still match, otherwise bakes and caches it
+void prepareTerrainLighting() {
+    terrainBake.lightmapSize = LIGHTMAP_SIZE;
+    terrainBake.sourceHash = hashTerrainBakeInputs(LIGHTMAP_SIZE);
+    terrainBake.fromCache = loadTerrainBakeCache(terrainBake, TERRAIN_BAKE_CACHE);
+    if (terrainBake.fromCache) {
+        std::cout << "Terrain bake loaded from " << TERRAIN_BAKE_CACHE << "\n";
+    }
+    else {
+        const int threads = workerThreadCount();
+        bakeTerrainLighting(terrainBake, LIGHTMAP_SIZE, threads);
+        saveTerrainBakeCache(terrainBake, TERRAIN_BAKE_CACHE);
+        float texels = (float)LIGHTMAP_SIZE * LIGHTMAP_SIZE;
+        std::cout << "Terrain bake: " << (int)texels << " texels + " << terrainBake.normals.size() << " vertices in "
+            << terrainBake.bakeMs << " ms on " << threads << " threads ("
+            << texels / (terrainBake.bakeMs * 1000.0f) << " Mtexel/s)\n";
+    }
+
+    glGenTextures(1, &terrainBake.lightmapTexture);
+    glBindTexture(GL_TEXTURE_2D, terrainBake.lightmapTexture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    // Stored with s along x and t along z, matching the terrain's multitexture coordinates
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, LIGHTMAP_SIZE, LIGHTMAP_SIZE, 0, GL_RGB, GL_UNSIGNED_BYTE, terrainBake.lightmap.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+// Bake throughput at a larger lightmap, single vs multithreaded
+int runBakeBenchmark(int threads) {
+    threads = std::max(1, threads);
+    generateTerrain();
+    const int sizes[] = { 256, 512, 1024 };
+    std::cout << "Terrain bake benchmark (" << threads << " threads)\n";
+    for (int size : sizes) {
+        TerrainBake single, multi;
+        bakeTerrainLighting(single, size, 1);
+        bakeTerrainLighting(multi, size, threads);
+        float texels = (float)size * size;
+        bool identical = single.lightmap == multi.lightmap && single.occlusion == multi.occlusion;
+        std::cout << "  " << size << "x" << size
+            << "  1 thread: " << single.bakeMs << " ms (" << texels / (single.bakeMs * 1000.0f) << " Mtexel/s)"
+            << "  " << threads << " threads: " << multi.bakeMs << " ms (" << texels / (multi.bakeMs * 1000.0f) << " Mtexel/s)"
+            << "  identical: " << (identical ? "yes" : "NO") << "\n";
+        if (!identical) return 1;
+    }
+    return 0;
 }
 
 // ---------------------- House (fixed texture coords & no invalid stack ops) ----------------------
@@ -510,13 +1755,19 @@ void drawHouse() {
 }
 
 // ---------------------- Advanced Wind Turbine (integrated) ----------------------
-void drawWindTurbine() {
+void drawWindTurbine(int index) {
+    const float swayX = turbineFarm.swayX[index], swayZ = turbineFarm.swayZ[index];
     // Place base at current model origin (y=0) and build upward
     glPushMatrix();
 
     // Foundation
     drawFoundation();
 
+    // Tower and everything above it lean with the wind load (skipped in calm air, where the
+    // sway vector and so the rotation axis is zero)
+    float lean = turbineLeanDegrees(swayX, swayZ, turbineParams.height);
+    if (lean > MIN_LEAN_DEGREES) glRotatef(lean, swayZ, 0.0f, -swayX);
+
     // Tower (rotate so axis points up)
     glPushMatrix();
     glTranslatef(0.0f, turbineParams.foundationHeight, 0.0f);
@@ -526,12 +1777,12 @@ void drawWindTurbine() {
     // Nacelle & rotor at top
     glPushMatrix();
     glTranslatef(0.0f, turbineParams.foundationHeight + turbineParams.height, 0.0f);
-    glRotatef(nacelle_yaw, 0.0f, 1.0f, 0.0f);
+    glRotatef(turbineFarm.yaw[index], 0.0f, 1.0f, 0.0f);
     // nacelle body
     drawNacelle();
     // move forward from nacelle center to rotor mount and draw rotor
     glTranslatef(turbineParams.nacelleLength * 0.6f, 0.0f, 0.0f);
-    drawRotorSystem();
+    drawRotorSystem(turbineFarm.rotorAngle[index]);
     glPopMatrix();
 
     glPopMatrix();
@@ -552,7 +1803,8 @@ void drawFoundation() {
     glPushMatrix();
     glTranslatef(0.0f, turbineParams.foundationHeight * 0.8f, 0.0f);
     glRotatef(-90.0f, 1.0f, 0.0f, 0.0f);
-    drawTorus(turbineParams.foundationRadius * 1.1f, 0.5f, 24, 16);
+    drawTorus(turbineParams.foundationRadius * 1.1f, 0.5f,
+        turbineParams.ringMajorSegments, turbineParams.ringMinorSegments);
     glPopMatrix();
     glPopMatrix();
 }
@@ -571,7 +1823,8 @@ void drawNacelle() {
     glPushMatrix();
     // place the ellipsoid oriented along X
     glRotatef(90.0f, 0.0f, 1.0f, 0.0f);
-    drawEllipsoid(turbineParams.nacelleLength, turbineParams.nacelleHeight, turbineParams.nacelleWidth, 20);
+    drawEllipsoid(turbineParams.nacelleLength, turbineParams.nacelleHeight, turbineParams.nacelleWidth,
+        turbineParams.nacelleSegments);
     // vents / details
     glColor3f(0.3f, 0.3f, 0.3f);
     for (int i = 0; i < 8; ++i) {
@@ -589,15 +1842,15 @@ void drawNacelle() {
     glPopMatrix();
 }
 
-void drawRotorSystem() {
+void drawRotorSystem(float rotorAngle) {
     // hub
     drawHub();
 
     // blades (3)
     for (int i = 0; i < 3; ++i) {
         glPushMatrix();
-        // rotate so blades spin around X (use bladeRotation) and offset blades by 120 degrees
-        glRotatef(bladeRotation + i * 120.0f, 1.0f, 0.0f, 0.0f);
+        // rotate so blades spin around X (use rotorAngle) and offset blades by 120 degrees
+        glRotatef(rotorAngle + i * 120.0f, 1.0f, 0.0f, 0.0f);
         drawBlade(i * 120.0f);
         glPopMatrix();
     }
@@ -789,24 +2042,15 @@ void setupLighting() {
         glEnable(GL_LIGHT0);
         glEnable(GL_LIGHT1);
 
-        GLfloat lightPos[] = { 100.0f, 200.0f, 100.0f, 0.0f };
-        GLfloat lightAmbient[] = { 0.3f, 0.3f, 0.4f, 1.0f };
-        GLfloat lightDiffuse[] = { 1.0f, 0.95f, 0.8f, 1.0f };
-        GLfloat lightSpecular[] = { 1.0f, 1.0f, 0.9f, 1.0f };
+        glLightfv(GL_LIGHT0, GL_POSITION, SUN_POSITION);
+        glLightfv(GL_LIGHT0, GL_AMBIENT, SUN_AMBIENT);
+        glLightfv(GL_LIGHT0, GL_DIFFUSE, SUN_DIFFUSE);
+        glLightfv(GL_LIGHT0, GL_SPECULAR, SUN_SPECULAR);
 
-        glLightfv(GL_LIGHT0, GL_POSITION, lightPos);
-        glLightfv(GL_LIGHT0, GL_AMBIENT, lightAmbient);
-        glLightfv(GL_LIGHT0, GL_DIFFUSE, lightDiffuse);
-        glLightfv(GL_LIGHT0, GL_SPECULAR, lightSpecular);
+        glLightfv(GL_LIGHT1, GL_POSITION, FILL_POSITION);
+        glLightfv(GL_LIGHT1, GL_DIFFUSE, FILL_DIFFUSE);
 
-        GLfloat fillLightPos[] = { -50.0f, 50.0f, 50.0f, 1.0f };
-        GLfloat fillLightDiffuse[] = { 0.4f, 0.4f, 0.5f, 1.0f };
-
-        glLightfv(GL_LIGHT1, GL_POSITION, fillLightPos);
-        glLightfv(GL_LIGHT1, GL_DIFFUSE, fillLightDiffuse);
-
-        GLfloat globalAmbient[] = { 0.2f, 0.2f, 0.3f, 1.0f };
-        glLightModelfv(GL_LIGHT_MODEL_AMBIENT, globalAmbient);
+        glLightModelfv(GL_LIGHT_MODEL_AMBIENT, GLOBAL_AMBIENT);
     }
     else {
         glDisable(GL_LIGHTING);
@@ -840,7 +2084,10 @@ GLuint loadTexture(const char* filename) {
     );
     if (textureID == 0) {
         std::cerr << "Warning: could not load texture '" << filename << "'. Using procedural fallback.\n";
-        return createProceduralTexture(180, 160, 140, 20);
+        // FNV-1a of the filename: a stable id, independent of which textures loaded before
+        uint32_t textureId = 2166136261u;
+        for (const char* p = filename; *p; ++p) textureId = (textureId ^ (unsigned char)*p) * 16777619u;
+        return createProceduralTexture(180, 160, 140, 20, textureId);
     }
     glBindTexture(GL_TEXTURE_2D, textureID);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
@@ -850,13 +2097,17 @@ GLuint loadTexture(const char* filename) {
     return textureID;
 }
 
-GLuint createProceduralTexture(int r, int g, int b, int variation) {
+GLuint createProceduralTexture(int r, int g, int b, int variation, uint32_t textureId) {
+    // The RNG key comes from the texture's own id, so loading order never disturbs its noise
+    const uint32_t key = counterRandom(TERRAIN_SEED, textureId, 0, 2);
     const int texSize = 128;
     unsigned char* data = new unsigned char[texSize * texSize * 3];
     for (int i = 0; i < texSize * texSize; ++i) {
-        data[i * 3 + 0] = std::max(0, std::min(255, r + (rand() % variation) - variation / 2));
-        data[i * 3 + 1] = std::max(0, std::min(255, g + (rand() % variation) - variation / 2));
-        data[i * 3 + 2] = std::max(0, std::min(255, b + (rand() % variation) - variation / 2));
+        for (int c = 0; c < 3; ++c) {
+            int base = (c == 0) ? r : (c == 1) ? g : b;
+            int noise = (int)(counterRandom(key, i % texSize, i / texSize, c) % variation) - variation / 2;
+            data[i * 3 + c] = (unsigned char)std::max(0, std::min(255, base + noise));
+        }
     }
     GLuint tex;
     glGenTextures(1, &tex);
@@ -867,3 +2118,2312 @@ GLuint createProceduralTexture(int r, int g, int b, int variation) {
     delete[] data;
     return tex;
 }
+
+// ---------------------- GL extensions & offscreen rendering ----------------------
+void* getGLProcAddress(const char* name) {
+#ifdef _WIN32
+    return (void*)wglGetProcAddress(name);
+#else
+    return (void*)glXGetProcAddressARB((const GLubyte*)name);
+#endif
+}
+
+bool hasGLExtension(const char* name) {
+    const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+    if (!extensions) return false;
+    size_t len = std::strlen(name);
+    for (const char* p = extensions; (p = std::strstr(p, name)) != nullptr; p += len) {
+        if ((p == extensions || p[-1] == ' ') && (p[len] == ' ' || p[len] == '\0')) return true;
+    }
+    return false;
+}
+
+bool glVersionAtLeast(int major, int minor) {
+    const char* version = (const char*)glGetString(GL_VERSION);
+    int vMajor = 0, vMinor = 0;
+    if (!version || sscanf(version, "%d.%d", &vMajor, &vMinor) != 2) return false;
+    return vMajor > major || (vMajor == major && vMinor >= minor);
+}
+
+void loadGLExtensions() {
+    glExt.genFramebuffers = (GenFramebuffersProc)getGLProcAddress("glGenFramebuffersEXT");
+    glExt.bindFramebuffer = (BindFramebufferProc)getGLProcAddress("glBindFramebufferEXT");
+    glExt.genRenderbuffers = (GenRenderbuffersProc)getGLProcAddress("glGenRenderbuffersEXT");
+    glExt.bindRenderbuffer = (BindRenderbufferProc)getGLProcAddress("glBindRenderbufferEXT");
+    glExt.renderbufferStorage = (RenderbufferStorageProc)getGLProcAddress("glRenderbufferStorageEXT");
+    glExt.framebufferTexture2D = (FramebufferTexture2DProc)getGLProcAddress("glFramebufferTexture2DEXT");
+    glExt.framebufferRenderbuffer = (FramebufferRenderbufferProc)getGLProcAddress("glFramebufferRenderbufferEXT");
+    glExt.checkFramebufferStatus = (CheckFramebufferStatusProc)getGLProcAddress("glCheckFramebufferStatusEXT");
+    glExt.framebufferObjects = hasGLExtension("GL_EXT_framebuffer_object") &&
+        glExt.genFramebuffers && glExt.bindFramebuffer && glExt.genRenderbuffers &&
+        glExt.bindRenderbuffer && glExt.renderbufferStorage && glExt.framebufferTexture2D &&
+        glExt.framebufferRenderbuffer && glExt.checkFramebufferStatus;
+    if (!glExt.framebufferObjects) {
+        std::cerr << "Warning: framebuffer objects unavailable. Render scaling disabled.\n";
+    }
+
+    // Buffer objects are core in 1.5, otherwise fall back to the ARB entry points
+    bool coreBuffers = glVersionAtLeast(1, 5);
+    if (coreBuffers || hasGLExtension("GL_ARB_vertex_buffer_object")) {
+        glExt.genBuffers = (GenBuffersProc)getGLProcAddress(coreBuffers ? "glGenBuffers" : "glGenBuffersARB");
+        glExt.bindBuffer = (BindBufferProc)getGLProcAddress(coreBuffers ? "glBindBuffer" : "glBindBufferARB");
+        glExt.bufferData = (BufferDataProc)getGLProcAddress(coreBuffers ? "glBufferData" : "glBufferDataARB");
+        glExt.bufferSubData = (BufferSubDataProc)getGLProcAddress(coreBuffers ? "glBufferSubData" : "glBufferSubDataARB");
+        glExt.mapBuffer = (MapBufferProc)getGLProcAddress(coreBuffers ? "glMapBuffer" : "glMapBufferARB");
+        glExt.unmapBuffer = (UnmapBufferProc)getGLProcAddress(coreBuffers ? "glUnmapBuffer" : "glUnmapBufferARB");
+        glExt.bufferObjects = glExt.genBuffers && glExt.bindBuffer && glExt.bufferData &&
+            glExt.bufferSubData && glExt.mapBuffer && glExt.unmapBuffer;
+    }
+    if (!glExt.bufferObjects) {
+        std::cerr << "Warning: buffer objects unavailable. Particles use client-side arrays.\n";
+    }
+    glExt.pixelBufferObjects = glExt.bufferObjects && (glVersionAtLeast(2, 1) ||
+        hasGLExtension("GL_ARB_pixel_buffer_object") || hasGLExtension("GL_EXT_pixel_buffer_object"));
+
+    bool coreMultitexture = glVersionAtLeast(1, 3);
+    if (coreMultitexture || hasGLExtension("GL_ARB_multitexture")) {
+        glExt.activeTexture = (ActiveTextureProc)getGLProcAddress(coreMultitexture ? "glActiveTexture" : "glActiveTextureARB");
+        glExt.multiTexCoord2f = (MultiTexCoord2fProc)getGLProcAddress(coreMultitexture ? "glMultiTexCoord2f" : "glMultiTexCoord2fARB");
+        glExt.multitexture = glExt.activeTexture && glExt.multiTexCoord2f;
+    }
+
+    glExt.pointSprites = glVersionAtLeast(2, 0) || hasGLExtension("GL_ARB_point_sprite");
+    bool corePoints = glVersionAtLeast(1, 4);
+    if (corePoints || hasGLExtension("GL_ARB_point_parameters")) {
+        glExt.pointParameterf = (PointParameterfProc)getGLProcAddress(corePoints ? "glPointParameterf" : "glPointParameterfARB");
+        glExt.pointParameterfv = (PointParameterfvProc)getGLProcAddress(corePoints ? "glPointParameterfv" : "glPointParameterfvARB");
+        glExt.pointParameters = glExt.pointParameterf && glExt.pointParameterfv;
+    }
+
+    // Query objects are core in 1.5; the 64-bit result comes from ARB_timer_query (core in
+    // 3.3) or its EXT predecessor
+    bool arbTimer = glVersionAtLeast(3, 3) || hasGLExtension("GL_ARB_timer_query");
+    if (glVersionAtLeast(1, 5) && (arbTimer || hasGLExtension("GL_EXT_timer_query"))) {
+        glExt.genQueries = (GenQueriesProc)getGLProcAddress("glGenQueries");
+        glExt.beginQuery = (BeginQueryProc)getGLProcAddress("glBeginQuery");
+        glExt.endQuery = (EndQueryProc)getGLProcAddress("glEndQuery");
+        glExt.getQueryObjectiv = (GetQueryObjectivProc)getGLProcAddress("glGetQueryObjectiv");
+        glExt.getQueryObjectui64v = (GetQueryObjectui64vProc)getGLProcAddress(
+            arbTimer ? "glGetQueryObjectui64v" : "glGetQueryObjectui64vEXT");
+        glExt.timerQueries = glExt.genQueries && glExt.beginQuery && glExt.endQuery &&
+            glExt.getQueryObjectiv && glExt.getQueryObjectui64v;
+    }
+    if (!glExt.timerQueries) {
+        std::cerr << "Warning: timer queries unavailable. The quality governor times CPU work only.\n";
+    }
+}
+
+// (Re)allocates the target when the requested size changes
+bool ensureRenderTarget(RenderTarget& target, int width, int height) {
+    if (!glExt.framebufferObjects) return false;
+    if (target.fbo != 0 && target.width == width && target.height == height) return true;
+
+    if (target.fbo == 0) {
+        glExt.genFramebuffers(1, &target.fbo);
+        glGenTextures(1, &target.colorTexture);
+        glExt.genRenderbuffers(1, &target.depthBuffer);
+    }
+    target.width = width;
+    target.height = height;
+
+    glBindTexture(GL_TEXTURE_2D, target.colorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glExt.bindRenderbuffer(GL_RENDERBUFFER_EXT, target.depthBuffer);
+    glExt.renderbufferStorage(GL_RENDERBUFFER_EXT, GL_DEPTH24_STENCIL8_EXT, width, height);
+
+    glExt.bindFramebuffer(GL_FRAMEBUFFER_EXT, target.fbo);
+    glExt.framebufferTexture2D(GL_FRAMEBUFFER_EXT, GL_COLOR_ATTACHMENT0_EXT, GL_TEXTURE_2D, target.colorTexture, 0);
+    glExt.framebufferRenderbuffer(GL_FRAMEBUFFER_EXT, GL_DEPTH_ATTACHMENT_EXT, GL_RENDERBUFFER_EXT, target.depthBuffer);
+    glExt.framebufferRenderbuffer(GL_FRAMEBUFFER_EXT, GL_STENCIL_ATTACHMENT_EXT, GL_RENDERBUFFER_EXT, target.depthBuffer);
+    bool complete = glExt.checkFramebufferStatus(GL_FRAMEBUFFER_EXT) == GL_FRAMEBUFFER_COMPLETE_EXT;
+    glExt.bindFramebuffer(GL_FRAMEBUFFER_EXT, 0);
+
+    if (!complete) {
+        std::cerr << "Warning: offscreen target incomplete. Render scaling disabled.\n";
+        glExt.framebufferObjects = false;
+    }
+    return complete;
+}
+
+// Upscales the target's color texture over the whole viewport
+void drawRenderTarget(const RenderTarget& target) {
+    glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_LIGHTING);
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, target.colorTexture);
+    glColor3f(1, 1, 1);
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+    glLoadIdentity();
+    glMatrixMode(GL_MODELVIEW);
+    glPushMatrix();
+    glLoadIdentity();
+    glBegin(GL_QUADS);
+    glTexCoord2f(0, 0); glVertex2f(-1.0f, -1.0f);
+    glTexCoord2f(1, 0); glVertex2f(1.0f, -1.0f);
+    glTexCoord2f(1, 1); glVertex2f(1.0f, 1.0f);
+    glTexCoord2f(0, 1); glVertex2f(-1.0f, 1.0f);
+    glEnd();
+    glPopMatrix();
+    glMatrixMode(GL_PROJECTION);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+
+    glPopAttrib();
+}
+
+// ---------------------- Frame capture ----------------------
+// Output size is fixed for the whole capture (Y4M cannot change size mid-stream)
+void startFrameCapture(int width, int height) {
+    if (frameCapture.active) return;
+    const std::string& path = frameCapture.path;
+    bool y4m = path.size() >= 4 && path.compare(path.size() - 4, 4, ".y4m") == 0;
+    frameCapture.format = y4m ? CAPTURE_Y4M : CAPTURE_PNG;
+    frameCapture.width = width;
+    frameCapture.height = height;
+
+    if (y4m) {
+        frameCapture.stream = std::fopen(path.c_str(), "wb");
+        if (!frameCapture.stream) {
+            std::cerr << "Warning: could not open " << path << " for capture.\n";
+            return;
+        }
+        // 4:2:0 needs even dimensions; the encoder crops the last row/column if required
+        std::fprintf(frameCapture.stream, "YUV4MPEG2 W%d H%d F60:1 Ip A1:1 C420jpeg\n", width & ~1, height & ~1);
+    }
+    if (frameCapture.offscreen && !glExt.framebufferObjects) {
+        std::cerr << "Warning: framebuffer objects unavailable. Offscreen capture reads the hidden window.\n";
+    }
+
+    const size_t bytes = (size_t)width * height * 4;
+    if (glExt.pixelBufferObjects) {
+        if (frameCapture.pbos[0] == 0) glExt.genBuffers(CAPTURE_RING_SIZE, frameCapture.pbos);
+        for (int i = 0; i < CAPTURE_RING_SIZE; ++i) {
+            glExt.bindBuffer(GL_PIXEL_PACK_BUFFER, frameCapture.pbos[i]);
+            glExt.bufferData(GL_PIXEL_PACK_BUFFER, (ptrdiff_t)bytes, nullptr, GL_STREAM_READ);
+            frameCapture.slotFrame[i] = -1;
+        }
+        glExt.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    else {
+        std::cerr << "Warning: pixel buffer objects unavailable. Capture reads back synchronously.\n";
+    }
+    frameCapture.ringIndex = 0;
+
+    frameCapture.queue.clear();
+    frameCapture.freeFrames.resize(frameCapture.poolSize);
+    for (CaptureFrame& frame : frameCapture.freeFrames) frame.pixels.resize(bytes);
+    frameCapture.framesRead = frameCapture.framesEncoded = frameCapture.framesDropped = frameCapture.encodeErrors = 0;
+    frameCapture.quit = false;
+    frameCapture.encoder = std::thread(captureEncoderWorker);
+    static bool registered = false;
+    if (!registered) {
+        std::atexit(finishCaptureEncoder);
+        registered = true;
+    }
+    frameCapture.active = true;
+    std::cout << "Capture started: " << path << " (" << width << "x" << height
+        << (y4m ? ", y4m" : ", png sequence") << ")\n";
+}
+
+// Collects the readbacks still in the ring (waiting for the encoder rather than dropping), then
+// lets the encoder drain its queue
+void stopFrameCapture() {
+    if (!frameCapture.active) return;
+    for (int i = 0; i < CAPTURE_RING_SIZE; ++i) {
+        int slot = (frameCapture.ringIndex + i) % CAPTURE_RING_SIZE;
+        if (frameCapture.slotFrame[slot] >= 0) collectCaptureSlot(slot, true);
+    }
+    finishCaptureEncoder();
+    frameCapture.active = false;
+    std::cout << "Capture stopped: " << frameCapture.framesEncoded << " frames written, "
+        << frameCapture.framesDropped << " dropped, " << frameCapture.encodeErrors << " encode errors\n";
+}
+
+// Only flags the stop: flushing the ring needs the GL context, so update() does it
+void requestStop(int) {
+    stopRequested = 1;
+}
+
+// Starts this frame's readback and collects the one issued a ring-length ago
+void captureFrame(GLuint fbo, int width, int height) {
+    if (width != frameCapture.width || height != frameCapture.height) {
+        std::cerr << "Warning: output resized during capture. Stopping capture.\n";
+        stopFrameCapture();
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    if (fbo == 0) glReadBuffer(GL_BACK);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+    if (glExt.pixelBufferObjects) {
+        int slot = frameCapture.ringIndex;
+        if (frameCapture.slotFrame[slot] >= 0) collectCaptureSlot(slot, false);
+        glExt.bindBuffer(GL_PIXEL_PACK_BUFFER, frameCapture.pbos[slot]);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glExt.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        frameCapture.slotFrame[slot] = frameCapture.framesRead++;
+        frameCapture.ringIndex = (slot + 1) % CAPTURE_RING_SIZE;
+    }
+    else {
+        CaptureFrame frame;
+        if (takeCaptureFrame(frame, false)) {
+            glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, frame.pixels.data());
+            frame.index = frameCapture.framesRead;
+            {
+                std::lock_guard<std::mutex> lock(frameCapture.mutex);
+                frameCapture.queue.push_back(std::move(frame));
+            }
+            frameCapture.wake.notify_one();
+        }
+        frameCapture.framesRead++;
+    }
+    frameCapture.readbackMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    if (frameCapture.frameLimit > 0 && frameCapture.framesRead >= frameCapture.frameLimit) {
+        stopFrameCapture();
+        if (frameCapture.offscreen) std::exit(0);
+    }
+}
+
+// Maps a finished PBO and queues a copy. When no pooled frame is free the encoder is behind:
+// the frame is dropped (and never mapped) unless we are flushing
+bool collectCaptureSlot(int slot, bool wait) {
+    CaptureFrame frame;
+    frame.index = frameCapture.slotFrame[slot];
+    frameCapture.slotFrame[slot] = -1;
+    if (!takeCaptureFrame(frame, wait)) return false;
+
+    glExt.bindBuffer(GL_PIXEL_PACK_BUFFER, frameCapture.pbos[slot]);
+    const void* pixels = glExt.mapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+    bool mapped = pixels != nullptr;
+    if (mapped) {
+        std::memcpy(frame.pixels.data(), pixels, frame.pixels.size());
+        glExt.unmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glExt.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    {
+        std::lock_guard<std::mutex> lock(frameCapture.mutex);
+        if (mapped) frameCapture.queue.push_back(std::move(frame));
+        else {
+            frameCapture.framesDropped++;
+            frameCapture.freeFrames.push_back(std::move(frame));
+        }
+    }
+    if (mapped) frameCapture.wake.notify_one();
+    return mapped;
+}
+
+bool takeCaptureFrame(CaptureFrame& frame, bool wait) {
+    std::unique_lock<std::mutex> lock(frameCapture.mutex);
+    if (wait) frameCapture.released.wait(lock, [] { return !frameCapture.freeFrames.empty(); });
+    if (frameCapture.freeFrames.empty()) {
+        frameCapture.framesDropped++;
+        return false;
+    }
+    int index = frame.index;
+    frame = std::move(frameCapture.freeFrames.back());
+    frame.index = index;
+    frameCapture.freeFrames.pop_back();
+    return true;
+}
+
+void captureEncoderWorker() {
+    std::vector<unsigned char> scratch;
+    for (;;) {
+        std::unique_lock<std::mutex> lock(frameCapture.mutex);
+        frameCapture.wake.wait(lock, [] { return !frameCapture.queue.empty() || frameCapture.quit; });
+        if (frameCapture.queue.empty()) return; // quit, and everything queued has been written
+        CaptureFrame frame = std::move(frameCapture.queue.front());
+        frameCapture.queue.pop_front();
+        lock.unlock();
+
+        auto start = std::chrono::steady_clock::now();
+        bool ok = encodeCaptureFrame(frame, scratch);
+        float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        lock.lock();
+        frameCapture.encodeMs = ms;
+        if (ok) frameCapture.framesEncoded++;
+        else frameCapture.encodeErrors++;
+        frameCapture.freeFrames.push_back(std::move(frame));
+        lock.unlock();
+        frameCapture.released.notify_one();
+    }
+}
+
+// Also registered with atexit, so the encoder is joined (and the stream closed) on any exit
+void finishCaptureEncoder() {
+    {
+        std::lock_guard<std::mutex> lock(frameCapture.mutex);
+        frameCapture.quit = true;
+    }
+    frameCapture.wake.notify_one();
+    if (frameCapture.encoder.joinable()) frameCapture.encoder.join();
+    if (frameCapture.stream) {
+        std::fclose(frameCapture.stream);
+        frameCapture.stream = nullptr;
+    }
+}
+
+bool encodeCaptureFrame(const CaptureFrame& frame, std::vector<unsigned char>& scratch) {
+    const int width = frameCapture.width, height = frameCapture.height;
+    if (frameCapture.format == CAPTURE_Y4M) {
+        const int w = width & ~1, h = height & ~1;
+        scratch.resize((size_t)w * h * 3 / 2);
+        convertFrameToYuv420(frame.pixels.data(), width, height, scratch.data());
+        return std::fputs("FRAME\n", frameCapture.stream) >= 0 &&
+            std::fwrite(scratch.data(), 1, scratch.size(), frameCapture.stream) == scratch.size();
+    }
+
+    // PNG: flip to top-down and drop alpha
+    scratch.resize((size_t)width * height * 3);
+    for (int y = 0; y < height; ++y) {
+        const unsigned char* src = &frame.pixels[(size_t)(height - 1 - y) * width * 4];
+        unsigned char* dst = &scratch[(size_t)y * width * 3];
+        for (int x = 0; x < width; ++x, src += 4, dst += 3) {
+            dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2];
+        }
+    }
+    std::string prefix = frameCapture.path;
+    if (prefix.size() >= 4 && prefix.compare(prefix.size() - 4, 4, ".png") == 0) prefix.resize(prefix.size() - 4);
+    char suffix[32];
+    std::snprintf(suffix, sizeof(suffix), "_%05d.png", frame.index);
+    return SOIL_save_image((prefix + suffix).c_str(), SOIL_SAVE_TYPE_PNG, width, height, 3, scratch.data()) != 0;
+}
+
+// Bottom-up RGBA to planar full-range BT.601 4:2:0 (Y4M C420jpeg), cropped to even dimensions
+void convertFrameToYuv420(const unsigned char* rgba, int width, int height, unsigned char* out) {
+    const int w = width & ~1, h = height & ~1;
+    unsigned char* planeY = out;
+    unsigned char* planeU = out + (size_t)w * h;
+    unsigned char* planeV = planeU + (size_t)(w / 2) * (h / 2);
+    for (int y = 0; y < h; y += 2) {
+        const unsigned char* rows[2] = {
+            rgba + (size_t)(height - 1 - y) * width * 4,
+            rgba + (size_t)(height - 2 - y) * width * 4
+        };
+        for (int x = 0; x < w; x += 2) {
+            int sumR = 0, sumG = 0, sumB = 0;
+            for (int dy = 0; dy < 2; ++dy) {
+                for (int dx = 0; dx < 2; ++dx) {
+                    const unsigned char* p = rows[dy] + (x + dx) * 4;
+                    planeY[(size_t)(y + dy) * w + x + dx] = (unsigned char)((77 * p[0] + 150 * p[1] + 29 * p[2] + 128) >> 8);
+                    sumR += p[0]; sumG += p[1]; sumB += p[2];
+                }
+            }
+            // Chroma from the 2x2 average (sums are 4x, hence the extra >> 2)
+            int u = (-43 * sumR - 85 * sumG + 128 * sumB + 512) >> 10;
+            int v = (128 * sumR - 107 * sumG - 21 * sumB + 512) >> 10;
+            size_t c = (size_t)(y / 2) * (w / 2) + x / 2;
+            planeU[c] = (unsigned char)std::max(0, std::min(255, u + 128));
+            planeV[c] = (unsigned char)std::max(0, std::min(255, v + 128));
+        }
+    }
+}
+
+// ---------------------- Adaptive quality & stats ----------------------
+void recordFrameTime() {
+    auto now = std::chrono::steady_clock::now();
+    frameStats.workStart = now;
+    beginGpuTimer();
+    if (!frameStats.started) {
+        frameStats.started = true;
+        frameStats.lastFrame = now;
+        frameStats.lastReport = now;
+        return;
+    }
+    frameStats.frameMs = std::chrono::duration<float, std::milli>(now - frameStats.lastFrame).count();
+    frameStats.lastFrame = now;
+    frameStats.framesSinceReport++;
+
+    if (std::chrono::duration<float>(now - frameStats.lastReport).count() >= 1.0f) {
+        printFrameStats();
+        frameStats.lastReport = now;
+        frameStats.framesSinceReport = 0;
+    }
+}
+
+// Times the frame's own work, which vsync does not cap the way it caps the frame interval.
+// CPU and GPU overlap, so the slower of the two bounds the frame; neither is waited for.
+void finishFrameWork() {
+    if (!frameStats.started) return;
+    frameStats.cpuMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameStats.workStart).count();
+    frameStats.gpuMs = endGpuTimer();
+    reportFrameWork(std::max(frameStats.cpuMs, frameStats.gpuMs));
+}
+
+// Opens this frame's GL_TIME_ELAPSED query. A slot still in flight means the GPU is a whole
+// ring behind; that frame goes untimed rather than waiting for it.
+void beginGpuTimer() {
+    if (!glExt.timerQueries || !governor.enabled) return;
+    if (frameStats.gpuQueries[0] == 0) glExt.genQueries(GPU_TIMER_RING, frameStats.gpuQueries);
+    int slot = frameStats.gpuRing;
+    if (frameStats.gpuPending[slot]) return;
+    glExt.beginQuery(GL_TIME_ELAPSED, frameStats.gpuQueries[slot]);
+    frameStats.gpuTiming = true;
+}
+
+// Closes the open query and collects finished ones, oldest first, without blocking.
+// Returns the newest GPU time known
+float endGpuTimer() {
+    if (frameStats.gpuTiming) {
+        glExt.endQuery(GL_TIME_ELAPSED);
+        frameStats.gpuPending[frameStats.gpuRing] = true;
+        frameStats.gpuRing = (frameStats.gpuRing + 1) % GPU_TIMER_RING;
+        frameStats.gpuTiming = false;
+    }
+    float gpuMs = frameStats.gpuMs;
+    for (int i = 0; i < GPU_TIMER_RING; ++i) {
+        int slot = (frameStats.gpuRing + i) % GPU_TIMER_RING;
+        if (!frameStats.gpuPending[slot]) continue;
+        GLint available = 0;
+        glExt.getQueryObjectiv(frameStats.gpuQueries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) break; // later queries finish after this one
+        uint64_t ns = 0;
+        glExt.getQueryObjectui64v(frameStats.gpuQueries[slot], GL_QUERY_RESULT, &ns);
+        gpuMs = (float)(ns / 1.0e6);
+        frameStats.gpuPending[slot] = false;
+    }
+    return gpuMs;
+}
+
+// The first frame has no interval to pair with, and stalls (window drags, breakpoints) are
+// ignored so they do not drop quality
+void reportFrameWork(float workMs) {
+    frameStats.workMs = workMs;
+    if (frameStats.frameMs > 0.0f && frameStats.frameMs < 250.0f) updateQualityGovernor(frameStats.frameMs, workMs);
+}
+
+void updateQualityGovernor(float frameMs, float workMs) {
+    governor.smoothedFrameMs = (governor.smoothedFrameMs == 0.0f)
+        ? frameMs : governor.smoothedFrameMs * 0.9f + frameMs * 0.1f;
+    governor.smoothedWorkMs = (governor.smoothedWorkMs == 0.0f)
+        ? workMs : governor.smoothedWorkMs * 0.9f + workMs * 0.1f;
+    governor.framesSinceChange++;
+    if (!governor.enabled || governor.framesSinceChange < governor.settleFrames) return;
+
+    float quality = governor.quality;
+    if (governor.smoothedWorkMs > governor.targetFrameMs * governor.downgradeRatio) {
+        quality = std::max(0.0f, quality - governor.step);
+    }
+    else if (governor.smoothedWorkMs < governor.targetFrameMs * governor.upgradeRatio) {
+        quality = std::min(1.0f, quality + governor.step);
+    }
+    if (quality == governor.quality) return;
+
+    governor.lastDecision = (quality > governor.quality) ? 1 : -1;
+    governor.quality = quality;
+    governor.framesSinceChange = 0;
+    applyQualitySettings();
+}
+
+// Maps the quality factor onto every tunable within its configured bounds
+void applyQualitySettings() {
+    const float q = governor.quality;
+    auto lerpInt = [q](int lo, int hi) { return lo + (int)((hi - lo) * q + 0.5f); };
+
+    turbineParams.segments = lerpInt(governor.minTowerSegments, governor.maxTowerSegments);
+    turbineParams.bladeSegments = lerpInt(governor.minBladeSegments, governor.maxBladeSegments);
+    turbineParams.nacelleSegments = lerpInt(governor.minNacelleSegments, governor.maxNacelleSegments);
+    turbineParams.ringMajorSegments = lerpInt(governor.minRingMajor, governor.maxRingMajor);
+    turbineParams.ringMinorSegments = lerpInt(governor.minRingMinor, governor.maxRingMinor);
+
+    governor.terrainError = governor.maxTerrainError + (governor.minTerrainError - governor.maxTerrainError) * q;
+    terrainLodStep = selectTerrainLodStep(governor.terrainError);
+
+    governor.renderScale = governor.minRenderScale + (governor.maxRenderScale - governor.minRenderScale) * q;
+    governor.particleFraction = governor.minParticleFraction + (governor.maxParticleFraction - governor.minParticleFraction) * q;
+}
+
+// Drives the governor with vsync-capped intervals: a heavy phase must degrade, then a light
+// phase (interval still pinned at the refresh period) must recover full quality
+int runGovernorTest() {
+    const float refreshMs = 1000.0f / 60.0f;
+
+    // Launch: the first frame reports no interval, then light frames must not drop quality
+    recordFrameTime();
+    reportFrameWork(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameStats.workStart).count());
+    bool launchSkipped = governor.smoothedWorkMs == 0.0f;
+    frameStats.frameMs = refreshMs;
+    for (int i = 0; i < 200; ++i) reportFrameWork(8.0f);
+    bool launchOk = launchSkipped && governor.quality == 1.0f && governor.lastDecision == 0;
+
+    int frame = 0;
+    for (; frame < 600; ++frame) updateQualityGovernor(std::max(refreshMs, 30.0f), 28.0f);
+    float degraded = governor.quality;
+    for (; frame < 3600 && governor.quality < 1.0f; ++frame) updateQualityGovernor(refreshMs, 8.0f);
+    int recoveredAt = frame;
+    // Work near the target holds steady rather than oscillating
+    float held = governor.quality;
+    for (int i = 0; i < 600; ++i) updateQualityGovernor(refreshMs, 15.0f);
+
+    bool ok = launchOk && degraded < 1.0f && governor.quality == 1.0f && held == 1.0f;
+    std::cout << "Governor test: launch " << (launchOk ? "steady" : "degraded") << " | heavy phase quality " << degraded
+        << " | light phase recovered to " << held << " after " << recoveredAt - 600 << " frames"
+        << " | steady " << governor.quality << " -> " << (ok ? "ok" : "FAILED") << "\n";
+    return ok ? 0 : 1;
+}
+
+void printFrameStats() {
+    float seconds = std::chrono::duration<float>(frameStats.lastFrame - frameStats.lastReport).count();
+    float fps = seconds > 0.0f ? frameStats.framesSinceReport / seconds : 0.0f;
+    const char* decision = governor.lastDecision > 0 ? "up" : governor.lastDecision < 0 ? "down" : "none";
+
+    std::cout << "[stats] fps " << fps
+        << " | frame " << governor.smoothedFrameMs << " ms, work " << governor.smoothedWorkMs
+        << " ms (cpu " << frameStats.cpuMs << ", gpu " << (glExt.timerQueries ? frameStats.gpuMs : 0.0f)
+        << ", target " << governor.targetFrameMs << ")"
+        << " | governor " << (governor.enabled ? "on" : "off")
+        << " quality " << governor.quality << " (last change " << decision << ")"
+        << " | tower " << turbineParams.segments
+        << " blade " << turbineParams.bladeSegments
+        << " nacelle " << turbineParams.nacelleSegments
+        << " ring " << turbineParams.ringMajorSegments << "x" << turbineParams.ringMinorSegments
+        << " | terrain step " << terrainLodStep << " (err " << governor.terrainError << ")"
+        << " | render scale " << (glExt.framebufferObjects ? governor.renderScale : 1.0f)
+        << " | particles " << governor.particleFraction
+        << "\n";
+    int refreshFrames = windField.rowsPerFrame > 0 ? (windField.height + windField.rowsPerFrame - 1) / windField.rowsPerFrame : 0;
+    std::cout << "[stats] wind turbines " << turbineFarm.count
+        << " | grid " << windField.width << "x" << windField.height
+        << " | field " << windField.fieldMs << " ms (kernel " << windField.kernelMs << " ms, " << windField.rowsPerFrame << " rows/frame, full refresh "
+        << refreshFrames << " frames, budget " << windField.budgetMs << " ms)"
+        << " | turbines " << turbineFarm.updateMs << " ms"
+        << "\n";
+    if (particleSystem.enabled) {
+        int active = 0;
+        for (const ParticleLayer& layer : particleSystem.layers) active += layer.activeBatches * PARTICLE_BATCH_SIZE;
+        std::cout << "[stats] particles " << active
+            << " | update " << particleSystem.updateMs << " ms"
+            << " | build+upload " << particleSystem.uploadMs << " ms"
+            << " | batches " << particleSystem.drawnBatches
+            << (glExt.bufferObjects ? " (vbo)" : " (client arrays)")
+            << "\n";
+    }
+    if (frameCapture.active) {
+        std::lock_guard<std::mutex> lock(frameCapture.mutex);
+        std::cout << "[stats] capture read " << frameCapture.framesRead
+            << " | encoded " << frameCapture.framesEncoded
+            << " | dropped " << frameCapture.framesDropped
+            << " | queued " << frameCapture.queue.size() << "/" << frameCapture.poolSize
+            << " | readback " << frameCapture.readbackMs << " ms"
+            << (glExt.pixelBufferObjects ? " (pbo ring)" : " (sync)")
+            << " | encode " << frameCapture.encodeMs << " ms"
+            << "\n";
+    }
+    if (renderPipeline.enabled) {
+        std::cout << "[stats] pipeline build " << renderPipeline.buildMs << " ms"
+            << " | replay " << renderPipeline.replayMs << " ms"
+            << " | wait " << renderPipeline.waitMs << " ms"
+            << " | latency " << renderPipeline.latencyMs << " ms"
+            << " | views " << renderPipeline.viewCount
+            << " | commands " << renderPipeline.commandCount
+            << " culled " << renderPipeline.culledObjects
+            << "\n";
+    }
+}
+
+// ---------------------- CPU-side math ----------------------
+// Four-wide float primitives. Loads/stores are unaligned so math types can live
+// anywhere (32-bit allocators only guarantee 8-byte alignment).
+#if defined(SCENE_SIMD_SSE)
+typedef __m128 simd4;
+inline simd4 simdLoad(const float* p) { return _mm_loadu_ps(p); }
+inline void simdStore(float* p, simd4 v) { _mm_storeu_ps(p, v); }
+inline simd4 simdSplat(float s) { return _mm_set1_ps(s); }
+inline simd4 simdAdd(simd4 a, simd4 b) { return _mm_add_ps(a, b); }
+inline simd4 simdMul(simd4 a, simd4 b) { return _mm_mul_ps(a, b); }
+inline simd4 simdMulAdd(simd4 a, simd4 b, simd4 c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+inline simd4 simdSub(simd4 a, simd4 b) { return _mm_sub_ps(a, b); }
+inline simd4 simdSqrt(simd4 a) { return _mm_sqrt_ps(a); }
+inline simd4 simdDiv(simd4 a, simd4 b) { return _mm_div_ps(a, b); }
+inline simd4 simdMax(simd4 a, simd4 b) { return _mm_max_ps(a, b); }
+inline simd4 simdLessMask(simd4 a, simd4 b) { return _mm_and_ps(_mm_cmplt_ps(a, b), _mm_set1_ps(1.0f)); }
+template <int X, int Y, int Z, int W> inline simd4 simdShuffle(simd4 a) { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(W, Z, Y, X)); }
+inline float simdSum(simd4 v) {
+    simd4 shuf = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+    simd4 sums = _mm_add_ps(v, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    return _mm_cvtss_f32(_mm_add_ss(sums, shuf));
+}
+#elif defined(SCENE_SIMD_NEON)
+typedef float32x4_t simd4;
+inline simd4 simdLoad(const float* p) { return vld1q_f32(p); }
+inline void simdStore(float* p, simd4 v) { vst1q_f32(p, v); }
+inline simd4 simdSplat(float s) { return vdupq_n_f32(s); }
+inline simd4 simdAdd(simd4 a, simd4 b) { return vaddq_f32(a, b); }
+inline simd4 simdMul(simd4 a, simd4 b) { return vmulq_f32(a, b); }
+inline simd4 simdMulAdd(simd4 a, simd4 b, simd4 c) { return vmlaq_f32(c, a, b); }
+inline simd4 simdSub(simd4 a, simd4 b) { return vsubq_f32(a, b); }
+#if defined(__aarch64__) || defined(_M_ARM64)
+inline simd4 simdSqrt(simd4 a) { return vsqrtq_f32(a); }
+inline simd4 simdDiv(simd4 a, simd4 b) { return vdivq_f32(a, b); }
+#else
+inline simd4 simdSqrt(simd4 a) {
+    float v[4];
+    vst1q_f32(v, a);
+    for (int i = 0; i < 4; ++i) v[i] = sqrtf(v[i]);
+    return vld1q_f32(v);
+}
+inline simd4 simdDiv(simd4 a, simd4 b) {
+    float x[4], y[4];
+    vst1q_f32(x, a);
+    vst1q_f32(y, b);
+    for (int i = 0; i < 4; ++i) x[i] /= y[i];
+    return vld1q_f32(x);
+}
+#endif
+inline simd4 simdMax(simd4 a, simd4 b) { return vmaxq_f32(a, b); }
+inline simd4 simdLessMask(simd4 a, simd4 b) { return vbslq_f32(vcltq_f32(a, b), vdupq_n_f32(1.0f), vdupq_n_f32(0.0f)); }
+template <int X, int Y, int Z, int W> inline simd4 simdShuffle(simd4 a) {
+    float v[4];
+    vst1q_f32(v, a);
+    float r[4] = { v[X], v[Y], v[Z], v[W] };
+    return vld1q_f32(r);
+}
+inline float simdSum(simd4 v) {
+    float32x2_t pair = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+    return vget_lane_f32(vpadd_f32(pair, pair), 0);
+}
+#else
+struct simd4 {
+    float v[4];
+};
+inline simd4 simdLoad(const float* p) { simd4 r = { { p[0], p[1], p[2], p[3] } }; return r; }
+inline void simdStore(float* p, simd4 a) { for (int i = 0; i < 4; ++i) p[i] = a.v[i]; }
+inline simd4 simdSplat(float s) { simd4 r = { { s, s, s, s } }; return r; }
+inline simd4 simdAdd(simd4 a, simd4 b) { for (int i = 0; i < 4; ++i) a.v[i] += b.v[i]; return a; }
+inline simd4 simdMul(simd4 a, simd4 b) { for (int i = 0; i < 4; ++i) a.v[i] *= b.v[i]; return a; }
+inline simd4 simdMulAdd(simd4 a, simd4 b, simd4 c) { for (int i = 0; i < 4; ++i) c.v[i] += a.v[i] * b.v[i]; return c; }
+inline simd4 simdSub(simd4 a, simd4 b) { for (int i = 0; i < 4; ++i) a.v[i] -= b.v[i]; return a; }
+inline simd4 simdSqrt(simd4 a) { for (int i = 0; i < 4; ++i) a.v[i] = sqrtf(a.v[i]); return a; }
+inline simd4 simdDiv(simd4 a, simd4 b) { for (int i = 0; i < 4; ++i) a.v[i] /= b.v[i]; return a; }
+inline simd4 simdMax(simd4 a, simd4 b) { for (int i = 0; i < 4; ++i) a.v[i] = std::max(a.v[i], b.v[i]); return a; }
+inline simd4 simdLessMask(simd4 a, simd4 b) { for (int i = 0; i < 4; ++i) a.v[i] = a.v[i] < b.v[i] ? 1.0f : 0.0f; return a; }
+template <int X, int Y, int Z, int W> inline simd4 simdShuffle(simd4 a) { simd4 r = { { a.v[X], a.v[Y], a.v[Z], a.v[W] } }; return r; }
+inline float simdSum(simd4 a) { return a.v[0] + a.v[1] + a.v[2] + a.v[3]; }
+#endif
+
+// Vec3 ops keep the pad lane at 0: add/sub/scale preserve it and the cross product's
+// shuffles leave 0 * 0 there
+Vec3 vec3Add(const Vec3& a, const Vec3& b) {
+    Vec3 r;
+    simdStore(&r.x, simdAdd(simdLoad(&a.x), simdLoad(&b.x)));
+    return r;
+}
+
+Vec3 vec3Sub(const Vec3& a, const Vec3& b) {
+    Vec3 r;
+    simdStore(&r.x, simdSub(simdLoad(&a.x), simdLoad(&b.x)));
+    return r;
+}
+
+Vec3 vec3Scale(const Vec3& v, float s) {
+    Vec3 r;
+    simdStore(&r.x, simdMul(simdLoad(&v.x), simdSplat(s)));
+    return r;
+}
+
+float vec3Dot(const Vec3& a, const Vec3& b) {
+    return simdSum(simdMul(simdLoad(&a.x), simdLoad(&b.x)));
+}
+
+// a x b = (a * b.yzx - a.yzx * b).yzx
+Vec3 vec3Cross(const Vec3& a, const Vec3& b) {
+    simd4 va = simdLoad(&a.x), vb = simdLoad(&b.x);
+    simd4 c = simdSub(simdMul(va, simdShuffle<1, 2, 0, 3>(vb)), simdMul(simdShuffle<1, 2, 0, 3>(va), vb));
+    Vec3 r;
+    simdStore(&r.x, simdShuffle<1, 2, 0, 3>(c));
+    return r;
+}
+
+Vec3 vec3Normalize(const Vec3& v) {
+    float len = sqrtf(vec3Dot(v, v));
+    return len > 0.0f ? vec3Scale(v, 1.0f / len) : v;
+}
+
+Vec4 vec4Add(const Vec4& a, const Vec4& b) {
+    Vec4 r;
+    simdStore(&r.x, simdAdd(simdLoad(&a.x), simdLoad(&b.x)));
+    return r;
+}
+
+Vec4 vec4Mul(const Vec4& a, const Vec4& b) {
+    Vec4 r;
+    simdStore(&r.x, simdMul(simdLoad(&a.x), simdLoad(&b.x)));
+    return r;
+}
+
+Vec4 vec4Scale(const Vec4& v, float s) {
+    Vec4 r;
+    simdStore(&r.x, simdMul(simdLoad(&v.x), simdSplat(s)));
+    return r;
+}
+
+float vec4Dot(const Vec4& a, const Vec4& b) {
+    return simdSum(simdMul(simdLoad(&a.x), simdLoad(&b.x)));
+}
+
+Quat quatFromAxisAngle(float angleDeg, float x, float y, float z) {
+    Vec3 axis = vec3Normalize(Vec3{ x, y, z, 0.0f });
+    float half = angleDeg * (float)M_PI / 360.0f;
+    float s = sinf(half);
+    Quat q = { axis.x * s, axis.y * s, axis.z * s, cosf(half) };
+    return q;
+}
+
+// Hamilton product: applying the result rotates by b, then by a. Each lane of a scales a
+// signed permutation of b
+Quat quatMultiply(const Quat& a, const Quat& b) {
+    static const float signX[4] = { 1, -1, 1, -1 }, signY[4] = { 1, 1, -1, -1 }, signZ[4] = { -1, 1, 1, -1 };
+    simd4 va = simdLoad(&a.x), vb = simdLoad(&b.x);
+    simd4 r = simdMul(simdShuffle<3, 3, 3, 3>(va), vb);
+    r = simdMulAdd(simdMul(simdShuffle<0, 0, 0, 0>(va), simdLoad(signX)), simdShuffle<3, 2, 1, 0>(vb), r);
+    r = simdMulAdd(simdMul(simdShuffle<1, 1, 1, 1>(va), simdLoad(signY)), simdShuffle<2, 3, 0, 1>(vb), r);
+    r = simdMulAdd(simdMul(simdShuffle<2, 2, 2, 2>(va), simdLoad(signZ)), simdShuffle<1, 0, 3, 2>(vb), r);
+    Quat q;
+    simdStore(&q.x, r);
+    return q;
+}
+
+// Reference implementation, kept as the benchmark baseline
+Quat quatMultiplyScalar(const Quat& a, const Quat& b) {
+    Quat r = {
+        a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y,
+        a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x,
+        a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w,
+        a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z };
+    return r;
+}
+
+// Each column is its identity column plus 2 * (two signed lane products); the sign
+// vectors also clear the w lane
+Mat4 quatToMat4(const Quat& q) {
+    static const float sign0a[4] = { -1, 1, 1, 0 }, sign0b[4] = { -1, 1, -1, 0 };
+    static const float sign1a[4] = { 1, -1, 1, 0 }, sign1b[4] = { -1, -1, 1, 0 };
+    static const float sign2a[4] = { 1, 1, -1, 0 }, sign2b[4] = { 1, -1, -1, 0 };
+    simd4 v = simdLoad(&q.x);
+    simd4 two = simdSplat(2.0f);
+    Mat4 r = mat4Identity();
+    // column 0: (-y, x, x) * (y, y, z) + (-z, w, -w) * (z, z, y)
+    simd4 c = simdMul(simdMul(simdShuffle<1, 0, 0, 3>(v), simdLoad(sign0a)), simdShuffle<1, 1, 2, 3>(v));
+    c = simdMulAdd(simdMul(simdShuffle<2, 3, 3, 3>(v), simdLoad(sign0b)), simdShuffle<2, 2, 1, 3>(v), c);
+    simdStore(r.m, simdMulAdd(c, two, simdLoad(r.m)));
+    // column 1: (y, -x, y) * (x, x, z) + (-w, -z, w) * (z, z, x)
+    c = simdMul(simdMul(simdShuffle<1, 0, 1, 3>(v), simdLoad(sign1a)), simdShuffle<0, 0, 2, 3>(v));
+    c = simdMulAdd(simdMul(simdShuffle<3, 2, 3, 3>(v), simdLoad(sign1b)), simdShuffle<2, 2, 0, 3>(v), c);
+    simdStore(r.m + 4, simdMulAdd(c, two, simdLoad(r.m + 4)));
+    // column 2: (z, z, -x) * (x, y, x) + (w, -w, -y) * (y, x, y)
+    c = simdMul(simdMul(simdShuffle<2, 2, 0, 3>(v), simdLoad(sign2a)), simdShuffle<0, 1, 0, 3>(v));
+    c = simdMulAdd(simdMul(simdShuffle<3, 3, 1, 3>(v), simdLoad(sign2b)), simdShuffle<1, 0, 1, 3>(v), c);
+    simdStore(r.m + 8, simdMulAdd(c, two, simdLoad(r.m + 8)));
+    return r;
+}
+
+// Reference implementation, kept as the benchmark baseline
+Mat4 quatToMat4Scalar(const Quat& q) {
+    float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+    Mat4 r = { {
+        1 - 2 * (yy + zz), 2 * (xy + wz),     2 * (xz - wy),     0,
+        2 * (xy - wz),     1 - 2 * (xx + zz), 2 * (yz + wx),     0,
+        2 * (xz + wy),     2 * (yz - wx),     1 - 2 * (xx + yy), 0,
+        0, 0, 0, 1 } };
+    return r;
+}
+
+Mat4 mat4Identity() {
+    Mat4 r = { { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 } };
+    return r;
+}
+
+// Each result column is a linear combination of a's columns weighted by b's column
+Mat4 mat4Multiply(const Mat4& a, const Mat4& b) {
+    simd4 a0 = simdLoad(a.m), a1 = simdLoad(a.m + 4), a2 = simdLoad(a.m + 8), a3 = simdLoad(a.m + 12);
+    Mat4 r;
+    for (int col = 0; col < 4; ++col) {
+        const float* bc = b.m + col * 4;
+        simd4 c = simdMul(a0, simdSplat(bc[0]));
+        c = simdMulAdd(a1, simdSplat(bc[1]), c);
+        c = simdMulAdd(a2, simdSplat(bc[2]), c);
+        c = simdMulAdd(a3, simdSplat(bc[3]), c);
+        simdStore(r.m + col * 4, c);
+    }
+    return r;
+}
+
+// Reference implementation, kept as the benchmark baseline
+Mat4 mat4MultiplyScalar(const Mat4& a, const Mat4& b) {
+    Mat4 r;
+    for (int col = 0; col < 4; ++col) {
+        for (int row = 0; row < 4; ++row) {
+            r.m[col * 4 + row] = a.m[0 * 4 + row] * b.m[col * 4 + 0] + a.m[1 * 4 + row] * b.m[col * 4 + 1] +
+                a.m[2 * 4 + row] * b.m[col * 4 + 2] + a.m[3 * 4 + row] * b.m[col * 4 + 3];
+        }
+    }
+    return r;
+}
+
+Vec4 mat4Transform(const Mat4& m, const Vec4& v) {
+    simd4 c = simdMul(simdLoad(m.m), simdSplat(v.x));
+    c = simdMulAdd(simdLoad(m.m + 4), simdSplat(v.y), c);
+    c = simdMulAdd(simdLoad(m.m + 8), simdSplat(v.z), c);
+    c = simdMulAdd(simdLoad(m.m + 12), simdSplat(v.w), c);
+    Vec4 r;
+    simdStore(&r.x, c);
+    return r;
+}
+
+void mat4TransformBatch(const Mat4& m, const Vec4* in, Vec4* out, size_t count) {
+    simd4 c0 = simdLoad(m.m), c1 = simdLoad(m.m + 4), c2 = simdLoad(m.m + 8), c3 = simdLoad(m.m + 12);
+    for (size_t i = 0; i < count; ++i) {
+        simd4 c = simdMul(c0, simdSplat(in[i].x));
+        c = simdMulAdd(c1, simdSplat(in[i].y), c);
+        c = simdMulAdd(c2, simdSplat(in[i].z), c);
+        c = simdMulAdd(c3, simdSplat(in[i].w), c);
+        simdStore(&out[i].x, c);
+    }
+}
+
+Mat4 mat4FromTranslationRotation(float x, float y, float z, const Quat& rotation) {
+    Mat4 r = quatToMat4(rotation);
+    r.m[12] = x; r.m[13] = y; r.m[14] = z;
+    return r;
+}
+
+Mat4 mat4Translate(float x, float y, float z) {
+    Mat4 r = mat4Identity();
+    r.m[12] = x; r.m[13] = y; r.m[14] = z;
+    return r;
+}
+
+// Same convention as glRotatef: degrees about an arbitrary axis
+Mat4 mat4Rotate(float angleDeg, float x, float y, float z) {
+    float len = sqrtf(x * x + y * y + z * z);
+    if (len == 0.0f) return mat4Identity();
+    x /= len; y /= len; z /= len;
+    float rad = angleDeg * (float)M_PI / 180.0f;
+    float c = cosf(rad), s = sinf(rad), ic = 1.0f - c;
+    Mat4 r = { {
+        x * x * ic + c,     y * x * ic + z * s, x * z * ic - y * s, 0,
+        x * y * ic - z * s, y * y * ic + c,     y * z * ic + x * s, 0,
+        x * z * ic + y * s, y * z * ic - x * s, z * z * ic + c,     0,
+        0, 0, 0, 1 } };
+    return r;
+}
+
+// Same result as gluLookAt
+Mat4 mat4LookAt(float eyeX, float eyeY, float eyeZ, float centerX, float centerY, float centerZ,
+    float upX, float upY, float upZ) {
+    float fx = centerX - eyeX, fy = centerY - eyeY, fz = centerZ - eyeZ;
+    float fl = sqrtf(fx * fx + fy * fy + fz * fz);
+    fx /= fl; fy /= fl; fz /= fl;
+    float sx = fy * upZ - fz * upY, sy = fz * upX - fx * upZ, sz = fx * upY - fy * upX;
+    float sl = sqrtf(sx * sx + sy * sy + sz * sz);
+    sx /= sl; sy /= sl; sz /= sl;
+    float ux = sy * fz - sz * fy, uy = sz * fx - sx * fz, uz = sx * fy - sy * fx;
+    Mat4 r = { {
+        sx, ux, -fx, 0,
+        sy, uy, -fy, 0,
+        sz, uz, -fz, 0,
+        0, 0, 0, 1 } };
+    return mat4Multiply(r, mat4Translate(-eyeX, -eyeY, -eyeZ));
+}
+
+// Same result as gluPerspective
+Mat4 mat4Perspective(float fovyDeg, float aspect, float zNear, float zFar) {
+    float f = 1.0f / tanf(fovyDeg * (float)M_PI / 360.0f);
+    Mat4 r = { {
+        f / aspect, 0, 0, 0,
+        0, f, 0, 0,
+        0, 0, (zFar + zNear) / (zNear - zFar), -1,
+        0, 0, 2.0f * zFar * zNear / (zNear - zFar), 0 } };
+    return r;
+}
+
+// Same result as glOrtho
+Mat4 mat4Ortho(float left, float right, float bottom, float top, float zNear, float zFar) {
+    Mat4 r = { {
+        2.0f / (right - left), 0, 0, 0,
+        0, 2.0f / (top - bottom), 0, 0,
+        0, 0, -2.0f / (zFar - zNear), 0,
+        -(right + left) / (right - left), -(top + bottom) / (top - bottom), -(zFar + zNear) / (zFar - zNear), 1 } };
+    return r;
+}
+
+// Normalized planes (a, b, c, d) of a clip matrix, inside when a*x + b*y + c*z + d >= 0
+void extractFrustumPlanes(const Mat4& clip, float planes[6][4]) {
+    const float* m = clip.m;
+    for (int i = 0; i < 6; ++i) {
+        int row = i / 2;
+        float sign = (i % 2 == 0) ? 1.0f : -1.0f;
+        for (int c = 0; c < 4; ++c) planes[i][c] = m[c * 4 + 3] + sign * m[c * 4 + row];
+        float len = sqrtf(planes[i][0] * planes[i][0] + planes[i][1] * planes[i][1] + planes[i][2] * planes[i][2]);
+        for (int c = 0; c < 4; ++c) planes[i][c] /= len;
+    }
+}
+
+bool sphereInFrustum(const float planes[6][4], float x, float y, float z, float radius) {
+    for (int i = 0; i < 6; ++i) {
+        if (planes[i][0] * x + planes[i][1] * y + planes[i][2] * z + planes[i][3] < -radius) return false;
+    }
+    return true;
+}
+
+int addTransformNode(TransformHierarchy& hierarchy, int parent, const Mat4& local) {
+    hierarchy.parents.push_back(parent);
+    hierarchy.locals.push_back(local);
+    return (int)hierarchy.locals.size() - 1;
+}
+
+void updateWorldTransforms(TransformHierarchy& hierarchy) {
+    const size_t count = hierarchy.locals.size();
+    hierarchy.worlds.resize(count);
+    const int* parents = hierarchy.parents.data();
+    const Mat4* locals = hierarchy.locals.data();
+    Mat4* worlds = hierarchy.worlds.data();
+    for (size_t i = 0; i < count; ++i) {
+        worlds[i] = parents[i] < 0 ? locals[i] : mat4Multiply(worlds[parents[i]], locals[i]);
+    }
+}
+
+void updateWorldTransformsScalar(TransformHierarchy& hierarchy) {
+    const size_t count = hierarchy.locals.size();
+    hierarchy.worlds.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        int parent = hierarchy.parents[i];
+        hierarchy.worlds[i] = parent < 0 ? hierarchy.locals[i]
+            : mat4MultiplyScalar(hierarchy.worlds[parent], hierarchy.locals[i]);
+    }
+}
+
+// SIMD vs scalar: raw mat4 and quat products, quat conversion, point batches and a
+// 10k-turbine hierarchy update
+int runMathBenchmark() {
+#if defined(SCENE_SIMD_SSE)
+    const char* backend = "SSE";
+#elif defined(SCENE_SIMD_NEON)
+    const char* backend = "NEON";
+#else
+    const char* backend = "scalar fallback";
+#endif
+    std::cout << "Math benchmark (SIMD backend: " << backend << ")\n";
+    typedef std::chrono::steady_clock Clock;
+    auto ms = [](Clock::time_point a, Clock::time_point b) {
+        return std::chrono::duration<double, std::milli>(b - a).count();
+    };
+    auto maxDiff = [](const Mat4& a, const Mat4& b) {
+        float d = 0.0f;
+        for (int i = 0; i < 16; ++i) d = std::max(d, fabsf(a.m[i] - b.m[i]));
+        return d;
+    };
+
+    // Chained products so neither path can be hoisted out of the loop
+    const int products = 4000000;
+    Mat4 step = mat4Multiply(mat4Rotate(0.01f, 0.3f, 1.0f, 0.2f), mat4Translate(0.001f, 0.0f, 0.0f));
+    Mat4 scalarAcc = mat4Identity(), simdAcc = mat4Identity();
+    auto t0 = Clock::now();
+    for (int i = 0; i < products; ++i) scalarAcc = mat4MultiplyScalar(scalarAcc, step);
+    auto t1 = Clock::now();
+    for (int i = 0; i < products; ++i) simdAcc = mat4Multiply(simdAcc, step);
+    auto t2 = Clock::now();
+    std::cout << "  mat4 multiply x" << products << "  scalar: " << ms(t0, t1) << " ms  simd: " << ms(t1, t2)
+        << " ms  speedup: " << ms(t0, t1) / ms(t1, t2) << "x  max diff: " << maxDiff(scalarAcc, simdAcc) << "\n";
+
+    // Point batch
+    const size_t points = 2000000;
+    std::vector<Vec4> in(points), outScalar(points), outSimd(points);
+    for (size_t i = 0; i < points; ++i) in[i] = Vec4{ (float)(i % 97), (float)(i % 31), (float)(i % 13), 1.0f };
+    t0 = Clock::now();
+    for (size_t i = 0; i < points; ++i) {
+        const float* m = step.m;
+        const Vec4& v = in[i];
+        outScalar[i] = Vec4{ m[0] * v.x + m[4] * v.y + m[8] * v.z + m[12] * v.w,
+            m[1] * v.x + m[5] * v.y + m[9] * v.z + m[13] * v.w,
+            m[2] * v.x + m[6] * v.y + m[10] * v.z + m[14] * v.w,
+            m[3] * v.x + m[7] * v.y + m[11] * v.z + m[15] * v.w };
+    }
+    t1 = Clock::now();
+    mat4TransformBatch(step, in.data(), outSimd.data(), points);
+    t2 = Clock::now();
+    std::cout << "  transform " << points << " points  scalar: " << ms(t0, t1) << " ms  simd: " << ms(t1, t2)
+        << " ms  speedup: " << ms(t0, t1) / ms(t1, t2) << "x\n";
+
+    // Quaternion batches shaped like the turbines: yaw * blade spin, then quat -> matrix
+    const size_t rotations = 1000000;
+    std::vector<Quat> quats(rotations), spins(rotations), composedScalar(rotations), composedSimd(rotations);
+    std::vector<Mat4> rotScalar(rotations), rotSimd(rotations);
+    for (size_t i = 0; i < rotations; ++i) {
+        quats[i] = quatFromAxisAngle((float)(i % 360), (float)(i % 7) - 3.0f, 1.0f, (float)(i % 5));
+        spins[i] = quatFromAxisAngle((float)(i % 120) * 3.0f, 1.0f, 0.0f, 0.0f);
+    }
+    t0 = Clock::now();
+    for (size_t i = 0; i < rotations; ++i) composedScalar[i] = quatMultiplyScalar(quats[i], spins[i]);
+    t1 = Clock::now();
+    for (size_t i = 0; i < rotations; ++i) composedSimd[i] = quatMultiply(quats[i], spins[i]);
+    t2 = Clock::now();
+    float quatDiff = 0.0f;
+    for (size_t i = 0; i < rotations; ++i) {
+        const Quat& a = composedScalar[i];
+        const Quat& b = composedSimd[i];
+        quatDiff = std::max(quatDiff, std::max(std::max(fabsf(a.x - b.x), fabsf(a.y - b.y)), std::max(fabsf(a.z - b.z), fabsf(a.w - b.w))));
+    }
+    std::cout << "  quat multiply x" << rotations << "  scalar: " << ms(t0, t1) << " ms  simd: " << ms(t1, t2)
+        << " ms  speedup: " << ms(t0, t1) / ms(t1, t2) << "x  max diff: " << quatDiff << "\n";
+
+    t0 = Clock::now();
+    for (size_t i = 0; i < rotations; ++i) rotScalar[i] = quatToMat4Scalar(quats[i]);
+    t1 = Clock::now();
+    for (size_t i = 0; i < rotations; ++i) rotSimd[i] = quatToMat4(quats[i]);
+    t2 = Clock::now();
+    float rotDiff = 0.0f;
+    for (size_t i = 0; i < rotations; ++i) rotDiff = std::max(rotDiff, maxDiff(rotScalar[i], rotSimd[i]));
+    std::cout << "  quat to mat4 x" << rotations << "  scalar: " << ms(t0, t1) << " ms  simd: " << ms(t1, t2)
+        << " ms  speedup: " << ms(t0, t1) / ms(t1, t2) << "x  max diff: " << rotDiff << "\n";
+
+    // Vec3 cross/normalize against the written-out formulas
+    float vecDiff = 0.0f;
+    for (size_t i = 0; i < 1000; ++i) {
+        Vec3 a = { (float)(i % 13) - 6.0f, (float)(i % 7), 1.0f + i % 3, 0.0f };
+        Vec3 b = { 2.0f, (float)(i % 11) - 5.0f, (float)(i % 17), 0.0f };
+        Vec3 c = vec3Normalize(vec3Cross(a, b));
+        float rx = a.y * b.z - a.z * b.y, ry = a.z * b.x - a.x * b.z, rz = a.x * b.y - a.y * b.x;
+        float len = sqrtf(rx * rx + ry * ry + rz * rz);
+        if (len > 0.0f) { rx /= len; ry /= len; rz /= len; }
+        vecDiff = std::max(vecDiff, std::max(std::max(fabsf(c.x - rx), fabsf(c.y - ry)), std::max(fabsf(c.z - rz), fabsf(c.pad))));
+    }
+    std::cout << "  vec3 cross/normalize  max diff: " << vecDiff << "\n";
+
+    // Hierarchy shaped like the scene: root, then base/tower/top/rotor/3 blades per turbine
+    const int turbines = 10000;
+    TransformHierarchy scalarTree, simdTree;
+    int root = addTransformNode(scalarTree, -1, mat4Translate(0.3f, 0.0f, 0.1f));
+    for (int t = 0; t < turbines; ++t) {
+        int base = addTransformNode(scalarTree, root, mat4Translate((float)(t % 100) * 30.0f, 0.0f, (float)(t / 100) * 30.0f));
+        addTransformNode(scalarTree, base, mat4Translate(0.0f, 2.0f, 0.0f));
+        int top = addTransformNode(scalarTree, base,
+            mat4FromTranslationRotation(0.0f, 82.0f, 0.0f, quatFromAxisAngle((float)t, 0.0f, 1.0f, 0.0f)));
+        int rotor = addTransformNode(scalarTree, top, mat4Translate(7.2f, 0.0f, 0.0f));
+        for (int b = 0; b < 3; ++b) {
+            addTransformNode(scalarTree, rotor, quatToMat4(quatFromAxisAngle(b * 120.0f + t, 1.0f, 0.0f, 0.0f)));
+        }
+    }
+    simdTree = scalarTree;
+    const int passes = 50;
+    t0 = Clock::now();
+    for (int p = 0; p < passes; ++p) updateWorldTransformsScalar(scalarTree);
+    t1 = Clock::now();
+    for (int p = 0; p < passes; ++p) updateWorldTransforms(simdTree);
+    t2 = Clock::now();
+    float diff = 0.0f;
+    for (size_t i = 0; i < scalarTree.worlds.size(); ++i) diff = std::max(diff, maxDiff(scalarTree.worlds[i], simdTree.worlds[i]));
+    std::cout << "  hierarchy " << scalarTree.locals.size() << " nodes x" << passes << "  scalar: " << ms(t0, t1)
+        << " ms  simd: " << ms(t1, t2) << " ms  speedup: " << ms(t0, t1) / ms(t1, t2) << "x  max diff: " << diff << "\n";
+    return 0;
+}
+
+// ---------------------- Render command list pipeline ----------------------
+SceneSnapshot captureSceneSnapshot() {
+    SceneSnapshot snapshot;
+    snapshot.camera = camera;
+    snapshot.aspect = (float)glutGet(GLUT_WINDOW_WIDTH) / (float)std::max(1, glutGet(GLUT_WINDOW_HEIGHT));
+    snapshot.projectionMode = projectionMode;
+    snapshot.viewCount = viewCount;
+    snapshot.turbineX = turbineFarm.posX;
+    snapshot.turbineZ = turbineFarm.posZ;
+    snapshot.turbineYaw = turbineFarm.yaw;
+    snapshot.turbineRotor = turbineFarm.rotorAngle;
+    snapshot.turbineSwayX = turbineFarm.swayX;
+    snapshot.turbineSwayZ = turbineFarm.swayZ;
+    snapshot.turbine = turbineParams;
+    snapshot.captureTime = std::chrono::steady_clock::now();
+    return snapshot;
+}
+
+// Mirrors the renderScene()/drawWindTurbine() hierarchy with CPU matrices. Runs on the worker.
+// The hierarchy is built and transformed once; the close-up cameras then come from its results.
+void recordSceneCommands(const SceneSnapshot& snapshot, RenderCommandList& list) {
+    auto start = std::chrono::steady_clock::now();
+    const Camera& cam = snapshot.camera;
+    const TurbineGeometry& tp = snapshot.turbine;
+    list.captureTime = snapshot.captureTime;
+    list.culledObjects = 0;
+
+    // World transforms for every node in one flat pass
+    TransformHierarchy& tree = list.transforms;
+    tree.parents.clear();
+    tree.locals.clear();
+    const float hubHeight = tp.foundationHeight + tp.height;
+    int root = addTransformNode(tree, -1, mat4Identity());
+    int house = addTransformNode(tree, root, mat4Translate(0.0f, 1.5f, 0.0f));
+    const int turbines = (int)snapshot.turbineX.size();
+    std::vector<int> turbineNodes(turbines * 8); // base, mast, tower, top, rotor, 3 blades
+    for (int t = 0; t < turbines; ++t) {
+        int* n = &turbineNodes[t * 8];
+        float swayX = snapshot.turbineSwayX[t], swayZ = snapshot.turbineSwayZ[t];
+        float lean = turbineLeanDegrees(swayX, swayZ, tp.height);
+        n[0] = addTransformNode(tree, root, mat4Translate(snapshot.turbineX[t], 0.0f, snapshot.turbineZ[t]));
+        n[1] = addTransformNode(tree, n[0], lean > MIN_LEAN_DEGREES
+            ? quatToMat4(quatFromAxisAngle(lean, swayZ, 0.0f, -swayX)) : mat4Identity());
+        n[2] = addTransformNode(tree, n[1], mat4Translate(0.0f, tp.foundationHeight, 0.0f));
+        n[3] = addTransformNode(tree, n[1],
+            mat4FromTranslationRotation(0.0f, hubHeight, 0.0f, quatFromAxisAngle(snapshot.turbineYaw[t], 0.0f, 1.0f, 0.0f)));
+        n[4] = addTransformNode(tree, n[3], mat4Translate(tp.nacelleLength * 0.6f, 0.0f, 0.0f));
+        for (int i = 0; i < 3; ++i) {
+            n[5 + i] = addTransformNode(tree, n[4],
+                quatToMat4(quatFromAxisAngle(snapshot.turbineRotor[t] + i * 120.0f, 1.0f, 0.0f, 0.0f)));
+        }
+    }
+    updateWorldTransforms(tree);
+    const std::vector<Mat4>& world = tree.worlds;
+
+    // Views: main camera, top-down site map, then close-ups of the rotors facing the wind
+    const int viewTotal = std::max(1, std::min(MAX_VIEWS, snapshot.viewCount));
+    float rects[MAX_VIEWS][4];
+    layoutViews(viewTotal, snapshot.aspect, rects);
+    list.views.resize(viewTotal);
+    for (int v = 0; v < viewTotal; ++v) {
+        RenderView& view = list.views[v];
+        std::copy(rects[v], rects[v] + 4, view.rect);
+        view.commands.clear();
+        view.culledObjects = 0;
+        float aspect = snapshot.aspect * rects[v][2] / rects[v][3];
+        if (v == 0) {
+            view.projection = (snapshot.projectionMode == 0)
+                ? mat4Perspective(cam.zoom, aspect, 1.0f, 500.0f)
+                : mat4Ortho(-cam.zoom * aspect, cam.zoom * aspect, -cam.zoom, cam.zoom, -200.0f, 200.0f);
+            view.view = mat4LookAt(cam.x, cam.y, cam.z, cam.lookX, cam.lookY, cam.lookZ, 0.0f, 1.0f, 0.0f);
+        }
+        else if (v == 1) {
+            const float extent = TERRAIN_SIZE * TERRAIN_SCALE * 0.6f;
+            view.projection = mat4Ortho(-extent * aspect, extent * aspect, -extent, extent, 1.0f, 300.0f);
+            view.view = mat4LookAt(0.0f, 150.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f);
+        }
+        else {
+            // More close-ups than turbines: each repeat orbits the rotor to a new azimuth and
+            // backs off a little, so no two views show the same shot
+            const int closeUps = viewTotal - 2;
+            const int orbits = (closeUps + turbines - 1) / turbines;
+            const int orbit = (v - 2) / turbines;
+            const int* n = &turbineNodes[((v - 2) % turbines) * 8];
+            const float* rotor = world[n[4]].m + 12;
+            const float* axis = world[n[3]].m;      // rotor axis (+X of the nacelle)
+            const float* side = world[n[3]].m + 8;
+            float azimuth = orbit * 2.0f * (float)M_PI / orbits;
+            float c = cosf(azimuth), s = sinf(azimuth);
+            float distance = tp.bladeLength * (3.0f + orbit);
+            float offset[3];
+            for (int k = 0; k < 3; ++k) {
+                offset[k] = (axis[k] * c + side[k] * s) * distance + (side[k] * c - axis[k] * s) * tp.bladeLength;
+            }
+            view.projection = mat4Perspective(45.0f, aspect, 0.5f, 200.0f);
+            view.view = mat4LookAt(
+                rotor[0] + offset[0],
+                rotor[1] + offset[1] + tp.bladeLength * 0.5f,
+                rotor[2] + offset[2],
+                rotor[0], rotor[1], rotor[2], 0.0f, 1.0f, 0.0f);
+        }
+    }
+
+    // Frustum planes for every view, so each bounding sphere is built once and tested in one loop
+    float planes[MAX_VIEWS][6][4];
+    for (int v = 0; v < viewTotal; ++v) {
+        extractFrustumPlanes(mat4Multiply(list.views[v].projection, list.views[v].view), planes[v]);
+    }
+    const int firstView = snapshot.soloView >= 0 ? snapshot.soloView : 0;
+    const int lastView = snapshot.soloView >= 0 ? snapshot.soloView + 1 : viewTotal;
+
+    auto emit = [&list](int v, RenderCommandType type, const Mat4& modelView, float param) {
+        RenderCommand cmd;
+        cmd.modelView = modelView;
+        cmd.param = param;
+        cmd.type = type;
+        list.views[v].commands.push_back(cmd);
+    };
+    // Bit v set when view v sees the sphere
+    auto visibleViews = [&](float x, float y, float z, float radius) {
+        unsigned mask = 0;
+        for (int v = firstView; v < lastView; ++v) {
+            if (sphereInFrustum(planes[v], x, y, z, radius)) mask |= 1u << v;
+            else list.views[v].culledObjects++;
+        }
+        return mask;
+    };
+
+    for (int v = firstView; v < lastView; ++v) {
+        // The sky quad is a backdrop for perspective views only
+        if (v != 1 && !(v == 0 && snapshot.projectionMode != 0)) emit(v, CMD_SKY, mat4Identity(), 0.0f);
+        emit(v, CMD_TERRAIN, mat4Multiply(list.views[v].view, world[root]), 0.0f);
+    }
+
+    const float* housePos = world[house].m + 12;
+    unsigned houseMask = visibleViews(housePos[0], housePos[1], housePos[2], 5.0f);
+    for (int v = firstView; v < lastView; ++v) {
+        if (houseMask & (1u << v)) emit(v, CMD_HOUSE, mat4Multiply(list.views[v].view, world[house]), 0.0f);
+    }
+
+    // Sphere around tower and swept rotor
+    const float radius = std::max(hubHeight * 0.5f, tp.bladeLength) + tp.nacelleLength + hubHeight * 0.5f;
+    for (int t = 0; t < turbines; ++t) {
+        const int* n = &turbineNodes[t * 8];
+        const float* basePos = world[n[0]].m + 12;
+        unsigned mask = visibleViews(basePos[0], basePos[1] + hubHeight * 0.5f, basePos[2], radius);
+        for (int v = firstView; mask != 0 && v < lastView; ++v) {
+            if (!(mask & (1u << v))) continue;
+            const Mat4& viewMatrix = list.views[v].view;
+            emit(v, CMD_FOUNDATION, mat4Multiply(viewMatrix, world[n[0]]), 0.0f);
+            emit(v, CMD_TOWER, mat4Multiply(viewMatrix, world[n[2]]), 0.0f);
+            emit(v, CMD_NACELLE, mat4Multiply(viewMatrix, world[n[3]]), 0.0f);
+            emit(v, CMD_HUB, mat4Multiply(viewMatrix, world[n[4]]), 0.0f);
+            for (int i = 0; i < 3; ++i) emit(v, CMD_BLADE, mat4Multiply(viewMatrix, world[n[5 + i]]), i * 120.0f);
+        }
+    }
+
+    // Particles rebuild and upload their batches on every draw, so only the main view gets them
+    if (firstView == 0) emit(0, CMD_PARTICLES, list.views[0].view, 0.0f);
+
+    for (int v = firstView; v < lastView; ++v) {
+        RenderView& view = list.views[v];
+        // Batch each view by draw type (sky first, particles last) so like draws run back to back
+        std::stable_sort(view.commands.begin(), view.commands.end(),
+            [](const RenderCommand& a, const RenderCommand& b) { return a.type < b.type; });
+        list.culledObjects += view.culledObjects;
+    }
+
+    list.buildMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Main view fills the output; the site map is a square inset top right and close-ups
+// (4:3) run along the bottom
+void layoutViews(int count, float outputAspect, float rects[][4]) {
+    const float margin = 0.01f;
+    float main[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+    std::copy(main, main + 4, rects[0]);
+    if (count > 1) {
+        float h = 0.3f, w = h / outputAspect;
+        float map[4] = { 1.0f - w - margin, 1.0f - h - margin * outputAspect, w, h };
+        std::copy(map, map + 4, rects[1]);
+    }
+    int closeUps = count - 2;
+    if (closeUps <= 0) return;
+    float w = std::min(0.2f, (1.0f - margin * (closeUps + 1)) / closeUps);
+    float h = w * outputAspect * 0.75f;
+    for (int i = 0; i < closeUps; ++i) {
+        float rect[4] = { margin + i * (w + margin), margin * outputAspect, w, h };
+        std::copy(rect, rect + 4, rects[2 + i]);
+    }
+}
+
+// GL thread: only matrix loads and the existing draw functions. Insets clear their own
+// rectangle under a scissor; the output viewport set by display() defines the pixel size.
+void replayCommandList(const RenderCommandList& list) {
+    GLint output[4];
+    glGetIntegerv(GL_VIEWPORT, output);
+
+    for (size_t v = 0; v < list.views.size(); ++v) {
+        const RenderView& view = list.views[v];
+        GLint x = output[0] + (GLint)(view.rect[0] * output[2]);
+        GLint y = output[1] + (GLint)(view.rect[1] * output[3]);
+        GLsizei w = std::max(1, (int)(view.rect[2] * output[2]));
+        GLsizei h = std::max(1, (int)(view.rect[3] * output[3]));
+        glViewport(x, y, w, h);
+        if (v > 0) {
+            glEnable(GL_SCISSOR_TEST);
+            glScissor(x, y, w, h);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        }
+
+        glMatrixMode(GL_PROJECTION);
+        glLoadMatrixf(view.projection.m);
+        glMatrixMode(GL_MODELVIEW);
+        glLoadMatrixf(view.view.m);
+        setupLighting();
+
+        for (const RenderCommand& cmd : view.commands) {
+            glLoadMatrixf(cmd.modelView.m);
+            switch (cmd.type) {
+            case CMD_SKY:
+                glDisable(GL_DEPTH_TEST);
+                drawSky();
+                glEnable(GL_DEPTH_TEST);
+                break;
+            case CMD_TERRAIN: drawTerrain(); break;
+            case CMD_HOUSE: drawHouse(); break;
+            case CMD_FOUNDATION: drawFoundation(); break;
+            case CMD_TOWER: drawTurbineTower(); break;
+            case CMD_NACELLE: drawNacelle(); break;
+            case CMD_HUB: drawHub(); break;
+            case CMD_BLADE: drawBlade(cmd.param); break;
+            case CMD_PARTICLES: drawParticles(); break;
+            }
+        }
+    }
+    glDisable(GL_SCISSOR_TEST);
+    glViewport(output[0], output[1], output[2], output[3]);
+    if (!list.views.empty()) {
+        // Leave the main camera current, as the immediate path does
+        glMatrixMode(GL_PROJECTION);
+        glLoadMatrixf(list.views[0].projection.m);
+        glMatrixMode(GL_MODELVIEW);
+        glLoadMatrixf(list.views[0].view.m);
+    }
+    glColor3f(1, 1, 1);
+}
+
+// CPU side of multi-view: one merged recording against one independent recording per view
+int runViewBenchmark(int turbines) {
+    const int frames = 50;
+    TurbineFarm farm;
+    initTurbineFarm(farm, std::max(TURBINE_COUNT, turbines));
+
+    SceneSnapshot snapshot;
+    snapshot.aspect = 16.0f / 9.0f;
+    snapshot.turbineX = farm.posX;
+    snapshot.turbineZ = farm.posZ;
+    snapshot.turbineYaw = farm.yaw;
+    snapshot.turbineRotor = farm.rotorAngle;
+    snapshot.turbineSwayX = farm.swayX;
+    snapshot.turbineSwayZ = farm.swayZ;
+    snapshot.turbine = turbineParams;
+
+    std::cout << "View benchmark (" << farm.count << " turbines, " << frames << " frames, recording only)\n";
+    const int counts[3] = { 1, 4, MAX_VIEWS };
+    for (int views : counts) {
+        snapshot.viewCount = views;
+        RenderCommandList merged, single;
+        int mergedCommands = 0, independentCommands = 0;
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (int f = 0; f < frames; ++f) {
+            snapshot.soloView = -1;
+            recordSceneCommands(snapshot, merged);
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        for (int f = 0; f < frames; ++f) {
+            independentCommands = 0;
+            for (int v = 0; v < views; ++v) {
+                snapshot.soloView = v;
+                recordSceneCommands(snapshot, single);
+                independentCommands += (int)single.views[v].commands.size();
+            }
+        }
+        auto t2 = std::chrono::steady_clock::now();
+        for (const RenderView& view : merged.views) mergedCommands += (int)view.commands.size();
+
+        double mergedMs = std::chrono::duration<double, std::milli>(t1 - t0).count() / frames;
+        double independentMs = std::chrono::duration<double, std::milli>(t2 - t1).count() / frames;
+        std::cout << "  " << views << " view(s): merged " << mergedMs << " ms (" << mergedCommands << " commands)"
+            << " | " << views << " independent passes " << independentMs << " ms (" << independentCommands << " commands)"
+            << " | speedup " << independentMs / mergedMs << "x\n";
+    }
+    return 0;
+}
+
+// Waits for the in-flight list, hands the worker the next snapshot and returns the finished list
+const RenderCommandList& advanceRenderPipeline(const SceneSnapshot& next) {
+    std::unique_lock<std::mutex> lock(renderPipeline.mutex);
+    auto waitStart = std::chrono::steady_clock::now();
+    renderPipeline.done.wait(lock, [] { return !renderPipeline.hasJob && !renderPipeline.busy; });
+    renderPipeline.waitMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - waitStart).count();
+
+    if (!renderPipeline.primed) {
+        // First frame (or after a toggle): nothing in flight yet, record inline
+        recordSceneCommands(next, renderPipeline.lists[renderPipeline.recordIndex]);
+        renderPipeline.primed = true;
+    }
+
+    int finished = renderPipeline.recordIndex;
+    renderPipeline.recordIndex ^= 1;
+    renderPipeline.pending = next;
+    renderPipeline.hasJob = true;
+    lock.unlock();
+    renderPipeline.wake.notify_one();
+
+    const RenderCommandList& list = renderPipeline.lists[finished];
+    renderPipeline.buildMs = list.buildMs;
+    renderPipeline.commandCount = 0;
+    for (const RenderView& view : list.views) renderPipeline.commandCount += (int)view.commands.size();
+    renderPipeline.culledObjects = list.culledObjects;
+    renderPipeline.viewCount = (int)list.views.size();
+    return list;
+}
+
+void renderPipelineWorker() {
+    for (;;) {
+        std::unique_lock<std::mutex> lock(renderPipeline.mutex);
+        renderPipeline.wake.wait(lock, [] { return renderPipeline.hasJob || renderPipeline.quit; });
+        if (renderPipeline.quit) return;
+        SceneSnapshot snapshot = renderPipeline.pending;
+        RenderCommandList& list = renderPipeline.lists[renderPipeline.recordIndex];
+        renderPipeline.hasJob = false;
+        renderPipeline.busy = true;
+        lock.unlock();
+
+        recordSceneCommands(snapshot, list);
+
+        lock.lock();
+        renderPipeline.busy = false;
+        lock.unlock();
+        renderPipeline.done.notify_all();
+    }
+}
+
+void startRenderPipeline() {
+    renderPipeline.worker = std::thread(renderPipelineWorker);
+    std::atexit(stopRenderPipeline);
+}
+
+void stopRenderPipeline() {
+    {
+        std::lock_guard<std::mutex> lock(renderPipeline.mutex);
+        renderPipeline.quit = true;
+    }
+    renderPipeline.wake.notify_one();
+    if (renderPipeline.worker.joinable()) renderPipeline.worker.join();
+}
+
+// Lets the in-flight list finish and drops it, so the next frame re-primes from live state
+void drainRenderPipeline() {
+    std::unique_lock<std::mutex> lock(renderPipeline.mutex);
+    renderPipeline.done.wait(lock, [] { return !renderPipeline.hasJob && !renderPipeline.busy; });
+    renderPipeline.primed = false;
+}
+
+// ---------------------- Particles ----------------------
+void initParticles() {
+    GLuint cloudSprite = createParticleSprite("clouds.jpg");
+    GLuint softSprite = createParticleSprite(nullptr);
+
+    ParticleLayer& clouds = particleSystem.layers[PARTICLE_CLOUD];
+    initParticleLayer(clouds, PARTICLE_CLOUD, CLOUD_BATCHES, TERRAIN_SEED + 1);
+    clouds.drag = 0.2f;
+    clouds.windFactor = 0.3f;
+    clouds.pointSize = 96.0f;
+    clouds.alpha = 0.25f;
+    clouds.texture = cloudSprite;
+
+    ParticleLayer& dust = particleSystem.layers[PARTICLE_DUST];
+    initParticleLayer(dust, PARTICLE_DUST, DUST_BATCHES, TERRAIN_SEED + 2);
+    dust.drag = 2.0f;
+    dust.windFactor = 1.0f;
+    dust.lift = 0.4f;
+    dust.pointSize = 6.0f;
+    dust.color[0] = 200; dust.color[1] = 180; dust.color[2] = 140;
+    dust.alpha = 0.5f;
+    dust.texture = softSprite;
+
+    ParticleLayer& vortices = particleSystem.layers[PARTICLE_VORTEX];
+    initParticleLayer(vortices, PARTICLE_VORTEX, VORTEX_BATCHES, TERRAIN_SEED + 3);
+    vortices.drag = 1.5f;
+    vortices.windFactor = 0.8f;
+    vortices.pointSize = 10.0f;
+    vortices.color[0] = 235; vortices.color[1] = 240; vortices.color[2] = 250;
+    vortices.alpha = 0.35f;
+    vortices.texture = softSprite;
+
+    for (ParticleLayer& layer : particleSystem.layers) {
+        if (glExt.bufferObjects) glExt.genBuffers(1, &layer.vbo);
+    }
+}
+
+// Allocates the pool and spawns every particle with a random age so emission is staggered
+void initParticleLayer(ParticleLayer& layer, ParticleKind kind, int batchCount, uint32_t seed) {
+    const size_t count = (size_t)batchCount * PARTICLE_BATCH_SIZE;
+    layer.kind = kind;
+    layer.seed = seed;
+    layer.batchCount = batchCount;
+    layer.activeBatches = batchCount;
+    layer.posX.assign(count, 0.0f); layer.posY.assign(count, 0.0f); layer.posZ.assign(count, 0.0f);
+    layer.velX.assign(count, 0.0f); layer.velY.assign(count, 0.0f); layer.velZ.assign(count, 0.0f);
+    layer.age.assign(count, 0.0f);
+    layer.life.assign(count, 1.0f);
+    layer.spawnCount.assign(count, 0);
+    layer.batchDepth.assign(batchCount, 0.0f);
+    layer.batchOrder.resize(batchCount);
+
+    parallelFor(0, batchCount, workerThreadCount(), [&layer](int b0, int b1) {
+        for (int i = b0 * PARTICLE_BATCH_SIZE; i < b1 * PARTICLE_BATCH_SIZE; ++i) {
+            spawnParticle(layer, i);
+            layer.age[i] = counterUnit(counterRandom(layer.seed, i, 0, 7), 0) * layer.life[i];
+        }
+    });
+}
+
+// Re-emits one particle around its batch's anchor; the RNG is keyed by slot and spawn count
+// so emission is reproducible regardless of which thread does it
+void spawnParticle(ParticleLayer& layer, int index) {
+    const uint32_t key = counterRandom(layer.seed, index, layer.spawnCount[index]++, 0);
+    const int batch = index / PARTICLE_BATCH_SIZE;
+    auto rnd = [key](uint32_t stream) { return counterUnit(key, stream); };
+    // Roughly gaussian offset in [-1.5, 1.5]
+    auto spread = [&rnd](uint32_t stream) { return rnd(stream) + rnd(stream + 1) + rnd(stream + 2) - 1.5f; };
+
+    float x = 0.0f, y = 0.0f, z = 0.0f;
+    switch (layer.kind) {
+    case PARTICLE_CLOUD: {
+        // One bank per batch, flattened ellipsoid, carried along by the integrated wind drift
+        uint32_t bankKey = counterRandom(layer.seed, batch, 0, 9);
+        auto wrap = [](float v) { return v - 400.0f * floorf((v + 200.0f) / 400.0f); };
+        float cx = wrap(-200.0f + 400.0f * counterUnit(bankKey, 0) + layer.driftX);
+        float cz = wrap(-200.0f + 400.0f * counterUnit(bankKey, 1) + layer.driftZ);
+        float cy = 95.0f + 30.0f * counterUnit(bankKey, 2);
+        x = cx + spread(0) * 35.0f;
+        y = cy + spread(3) * 6.0f;
+        z = cz + spread(6) * 22.0f;
+        layer.life[index] = 25.0f + 20.0f * rnd(9);
+        break;
+    }
+    case PARTICLE_DUST: {
+        // One terrain tile per batch
+        int side = (int)ceilf(sqrtf((float)layer.batchCount));
+        float span = TERRAIN_SIZE * TERRAIN_SCALE / side;
+        float origin = -(TERRAIN_SIZE / 2) * TERRAIN_SCALE;
+        x = origin + ((batch % side) + rnd(0)) * span;
+        z = origin + ((batch / side) + rnd(1)) * span;
+        y = sampleTerrainHeight(x, z) + 0.2f + 1.5f * rnd(2);
+        layer.life[index] = 2.0f + 3.0f * rnd(3);
+        break;
+    }
+    case PARTICLE_VORTEX: {
+        // One blade tip per batch, released along the tip circle at the current rotor angle
+        const TurbineFarm& farm = turbineFarm;
+        int turbine = (batch / 3) % std::min(TURBINE_COUNT, farm.count);
+        int blade = batch % 3;
+        const TurbineGeometry& tp = turbineParams;
+        float theta = (farm.rotorAngle[turbine] + blade * 120.0f) * (float)M_PI / 180.0f;
+        float yaw = farm.yaw[turbine] * (float)M_PI / 180.0f;
+        float lx = tp.nacelleLength * 0.6f;
+        float ly = tp.bladeLength * cosf(theta);
+        float lz = tp.bladeLength * sinf(theta);
+        x = farm.posX[turbine] + farm.swayX[turbine] + lx * cosf(yaw) + lz * sinf(yaw) + spread(0) * 0.4f;
+        y = tp.foundationHeight + tp.height + ly + spread(3) * 0.4f;
+        z = farm.posZ[turbine] + farm.swayZ[turbine] - lx * sinf(yaw) + lz * cosf(yaw) + spread(6) * 0.4f;
+        layer.life[index] = 1.0f + 1.5f * rnd(9);
+        break;
+    }
+    }
+    layer.posX[index] = x; layer.posY[index] = y; layer.posZ[index] = z;
+    layer.velX[index] = 0.0f; layer.velY[index] = 0.0f; layer.velZ[index] = 0.0f;
+    layer.age[index] = 0.0f;
+}
+
+// Velocity relaxes toward (wind * windFactor, lift); position integrates; dead slots re-emit
+void updateParticleRange(ParticleLayer& layer, int begin, int end, float dt, const Vec3& wind) {
+    const float k = std::min(1.0f, layer.drag * dt);
+    float* px = layer.posX.data(); float* py = layer.posY.data(); float* pz = layer.posZ.data();
+    float* vx = layer.velX.data(); float* vy = layer.velY.data(); float* vz = layer.velZ.data();
+    float* age = layer.age.data();
+
+    const simd4 keep = simdSplat(1.0f - k), step = simdSplat(dt);
+    const simd4 targetX = simdSplat(wind.x * layer.windFactor * k);
+    const simd4 targetY = simdSplat(layer.lift * k);
+    const simd4 targetZ = simdSplat(wind.z * layer.windFactor * k);
+    int i = begin;
+    for (; i + 4 <= end; i += 4) {
+        simd4 nvx = simdMulAdd(simdLoad(vx + i), keep, targetX);
+        simd4 nvy = simdMulAdd(simdLoad(vy + i), keep, targetY);
+        simd4 nvz = simdMulAdd(simdLoad(vz + i), keep, targetZ);
+        simdStore(vx + i, nvx); simdStore(vy + i, nvy); simdStore(vz + i, nvz);
+        simdStore(px + i, simdMulAdd(nvx, step, simdLoad(px + i)));
+        simdStore(py + i, simdMulAdd(nvy, step, simdLoad(py + i)));
+        simdStore(pz + i, simdMulAdd(nvz, step, simdLoad(pz + i)));
+        simdStore(age + i, simdAdd(simdLoad(age + i), step));
+    }
+    for (; i < end; ++i) {
+        vx[i] = vx[i] * (1.0f - k) + wind.x * layer.windFactor * k;
+        vy[i] = vy[i] * (1.0f - k) + layer.lift * k;
+        vz[i] = vz[i] * (1.0f - k) + wind.z * layer.windFactor * k;
+        px[i] += vx[i] * dt; py[i] += vy[i] * dt; pz[i] += vz[i] * dt;
+        age[i] += dt;
+    }
+
+    for (i = begin; i < end; ++i) {
+        if (age[i] >= layer.life[i]) spawnParticle(layer, i);
+    }
+}
+
+// Same kernel one particle at a time; the benchmark baseline
+void updateParticleRangeScalar(ParticleLayer& layer, int begin, int end, float dt, const Vec3& wind) {
+    const float k = std::min(1.0f, layer.drag * dt);
+    for (int i = begin; i < end; ++i) {
+        layer.velX[i] = layer.velX[i] * (1.0f - k) + wind.x * layer.windFactor * k;
+        layer.velY[i] = layer.velY[i] * (1.0f - k) + layer.lift * k;
+        layer.velZ[i] = layer.velZ[i] * (1.0f - k) + wind.z * layer.windFactor * k;
+        layer.posX[i] += layer.velX[i] * dt;
+        layer.posY[i] += layer.velY[i] * dt;
+        layer.posZ[i] += layer.velZ[i] * dt;
+        layer.age[i] += dt;
+        if (layer.age[i] >= layer.life[i]) spawnParticle(layer, i);
+    }
+}
+
+void updateParticleLayer(ParticleLayer& layer, float dt, const Vec3& wind, int threads, bool simd) {
+    layer.driftX += wind.x * layer.windFactor * dt;
+    layer.driftZ += wind.z * layer.windFactor * dt;
+    poolParallelFor(0, layer.activeBatches, threads, [&](int b0, int b1) {
+        if (simd) updateParticleRange(layer, b0 * PARTICLE_BATCH_SIZE, b1 * PARTICLE_BATCH_SIZE, dt, wind);
+        else updateParticleRangeScalar(layer, b0 * PARTICLE_BATCH_SIZE, b1 * PARTICLE_BATCH_SIZE, dt, wind);
+    });
+}
+
+void updateParticles(float dt) {
+    if (!particleSystem.enabled) return;
+    auto start = std::chrono::steady_clock::now();
+    particleSystem.wind = currentWindVector();
+    for (ParticleLayer& layer : particleSystem.layers) {
+        layer.activeBatches = std::max(1, (int)ceilf(layer.batchCount * governor.particleFraction));
+        updateParticleLayer(layer, dt, particleSystem.wind, workerThreadCount(), particleSystem.useSimd);
+    }
+    // Dust only shows once there is wind to raise it
+    particleSystem.layers[PARTICLE_DUST].alphaScale = std::min(1.0f, windSpeed / 2.5f);
+    particleSystem.updateMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Writes one batch of vertices and returns the view-space depth of its centroid
+float buildParticleBatch(const ParticleLayer& layer, int batch, const float* modelView, ParticleVertex* out) {
+    const int begin = batch * PARTICLE_BATCH_SIZE;
+    const float alpha = layer.alpha * layer.alphaScale * 255.0f * 4.0f;
+    float sumX = 0.0f, sumY = 0.0f, sumZ = 0.0f;
+    for (int n = 0; n < PARTICLE_BATCH_SIZE; ++n) {
+        int i = begin + n;
+        float t = layer.age[i] / layer.life[i];
+        ParticleVertex& v = out[n];
+        v.x = layer.posX[i]; v.y = layer.posY[i]; v.z = layer.posZ[i];
+        v.r = layer.color[0]; v.g = layer.color[1]; v.b = layer.color[2];
+        v.a = (unsigned char)std::min(255.0f, alpha * t * (1.0f - t)); // fade in and out
+        sumX += v.x; sumY += v.y; sumZ += v.z;
+    }
+    float inv = 1.0f / PARTICLE_BATCH_SIZE;
+    return modelView[2] * sumX * inv + modelView[6] * sumY * inv + modelView[10] * sumZ * inv + modelView[14];
+}
+
+// Streams each layer into its buffer and draws batches back to front as point sprites.
+// Expects the view matrix on the modelview stack.
+void drawParticles() {
+    if (!particleSystem.enabled) return;
+    auto start = std::chrono::steady_clock::now();
+    float modelView[16];
+    glGetFloatv(GL_MODELVIEW_MATRIX, modelView);
+
+    glPushAttrib(GL_ENABLE_BIT | GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT | GL_POINT_BIT | GL_TEXTURE_BIT | GL_CURRENT_BIT);
+    glDisable(GL_LIGHTING);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+    if (glExt.pointSprites) {
+        glEnable(GL_POINT_SPRITE);
+        glTexEnvi(GL_POINT_SPRITE, GL_COORD_REPLACE, GL_TRUE);
+        glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE);
+    }
+    if (glExt.pointParameters) {
+        GLfloat attenuation[] = { 1.0f, 0.0f, 0.0004f };
+        glExt.pointParameterfv(GL_POINT_DISTANCE_ATTENUATION, attenuation);
+        glExt.pointParameterf(GL_POINT_SIZE_MIN, 1.0f);
+    }
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+
+    const int threads = workerThreadCount();
+    particleSystem.drawnBatches = 0;
+    for (ParticleLayer& layer : particleSystem.layers) {
+        const int batches = layer.activeBatches;
+        const size_t bytes = (size_t)batches * PARTICLE_BATCH_SIZE * sizeof(ParticleVertex);
+        if (layer.alpha * layer.alphaScale <= 0.0f) continue;
+
+        // Orphan and map the stream buffer so workers write straight into driver memory
+        ParticleVertex* dest = nullptr;
+        if (glExt.bufferObjects) {
+            glExt.bindBuffer(GL_ARRAY_BUFFER, layer.vbo);
+            glExt.bufferData(GL_ARRAY_BUFFER, (ptrdiff_t)bytes, nullptr, GL_STREAM_DRAW);
+            dest = (ParticleVertex*)glExt.mapBuffer(GL_ARRAY_BUFFER, GL_WRITE_ONLY);
+        }
+        bool mapped = dest != nullptr;
+        if (!mapped) {
+            layer.staging.resize((size_t)batches * PARTICLE_BATCH_SIZE);
+            dest = layer.staging.data();
+        }
+        poolParallelFor(0, batches, threads, [&](int b0, int b1) {
+            for (int b = b0; b < b1; ++b) {
+                layer.batchDepth[b] = buildParticleBatch(layer, b, modelView, dest + (size_t)b * PARTICLE_BATCH_SIZE);
+            }
+        });
+
+        const char* base = nullptr;
+        if (glExt.bufferObjects) {
+            if (mapped) glExt.unmapBuffer(GL_ARRAY_BUFFER);
+            else glExt.bufferSubData(GL_ARRAY_BUFFER, 0, (ptrdiff_t)bytes, layer.staging.data());
+        }
+        else {
+            base = (const char*)layer.staging.data();
+        }
+        glVertexPointer(3, GL_FLOAT, sizeof(ParticleVertex), base);
+        glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(ParticleVertex), base + 3 * sizeof(float));
+
+        // Most negative view-space z is farthest away
+        for (int b = 0; b < batches; ++b) layer.batchOrder[b] = b;
+        std::sort(layer.batchOrder.begin(), layer.batchOrder.begin() + batches,
+            [&layer](int a, int b) { return layer.batchDepth[a] < layer.batchDepth[b]; });
+
+        glPointSize(layer.pointSize);
+        if (glExt.pointSprites) applyTexture(layer.texture);
+        else glDisable(GL_TEXTURE_2D);
+        for (int n = 0; n < batches; ++n) {
+            glDrawArrays(GL_POINTS, layer.batchOrder[n] * PARTICLE_BATCH_SIZE, PARTICLE_BATCH_SIZE);
+        }
+        particleSystem.drawnBatches += batches;
+    }
+
+    if (glExt.bufferObjects) glExt.bindBuffer(GL_ARRAY_BUFFER, 0);
+    glDisableClientState(GL_COLOR_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+    if (glExt.pointSprites) glTexEnvi(GL_POINT_SPRITE, GL_COORD_REPLACE, GL_FALSE);
+    glPopAttrib();
+    particleSystem.uploadMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Soft round sprite; with an image, the image's luminance modulates the alpha for cloud detail
+GLuint createParticleSprite(const char* imageFile) {
+    const int size = 64;
+    int imageW = 0, imageH = 0, channels = 0;
+    unsigned char* image = imageFile ? SOIL_load_image(imageFile, &imageW, &imageH, &channels, SOIL_LOAD_RGB) : nullptr;
+    if (imageFile && !image) {
+        std::cerr << "Warning: could not load sprite '" << imageFile << "'. Using a soft disc.\n";
+    }
+
+    std::vector<unsigned char> data(size * size * 4);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            float dx = (x + 0.5f) / size * 2.0f - 1.0f;
+            float dy = (y + 0.5f) / size * 2.0f - 1.0f;
+            float falloff = std::max(0.0f, 1.0f - sqrtf(dx * dx + dy * dy));
+            falloff *= falloff;
+            unsigned char* texel = &data[(y * size + x) * 4];
+            float detail = 1.0f;
+            if (image) {
+                const unsigned char* src = &image[((y * imageH / size) * imageW + (x * imageW / size)) * 3];
+                texel[0] = src[0]; texel[1] = src[1]; texel[2] = src[2];
+                detail = (src[0] + src[1] + src[2]) / (3.0f * 255.0f);
+            }
+            else {
+                texel[0] = texel[1] = texel[2] = 255;
+            }
+            texel[3] = (unsigned char)(255.0f * falloff * detail);
+        }
+    }
+    if (image) SOIL_free_image_data(image);
+
+    GLuint tex;
+    glGenTextures(1, &tex);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    return tex;
+}
+
+// Mean wind of the field in world units per second (particles use the mean, not local samples)
+Vec3 currentWindVector() {
+    float dir = windField.meanDirection * (float)M_PI / 180.0f;
+    float speed = windField.meanSpeed * windField.advection;
+    Vec3 wind = { -cosf(dir) * speed, 0.0f, sinf(dir) * speed, 0.0f };
+    return wind;
+}
+
+// Update and vertex-build cost per million particles: scalar vs SIMD, one vs many threads
+int runParticleBenchmark(int threads) {
+    threads = std::max(1, threads);
+    generateTerrain();
+    const int batches = (1 << 20) / PARTICLE_BATCH_SIZE;
+    const int steps = 20;
+    const float millions = batches * PARTICLE_BATCH_SIZE / 1.0e6f;
+    const Vec3 wind = { -4.0f, 0.0f, 1.0f, 0.0f };
+    std::cout << "Particle benchmark (" << batches * PARTICLE_BATCH_SIZE << " particles, " << steps << " steps)\n";
+
+    auto run = [&](const char* label, int threadCount, bool simd) {
+        ParticleLayer layer;
+        initParticleLayer(layer, PARTICLE_DUST, batches, TERRAIN_SEED);
+        auto t0 = std::chrono::steady_clock::now();
+        for (int s = 0; s < steps; ++s) updateParticleLayer(layer, 0.016f, wind, threadCount, simd);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        std::cout << "  update " << label << ": " << ms / steps / millions << " ms per million per step\n";
+        return layer;
+    };
+    run("scalar, 1 thread", 1, false);
+    run("simd, 1 thread", 1, true);
+    ParticleLayer layer = run(threads > 1 ? "simd, multithreaded" : "simd, multithreaded (1 thread)", threads, true);
+
+    std::vector<ParticleVertex> vertices((size_t)batches * PARTICLE_BATCH_SIZE);
+    Mat4 view = mat4LookAt(50.0f, 30.0f, 80.0f, 0.0f, 20.0f, 0.0f, 0.0f, 1.0f, 0.0f);
+    auto t0 = std::chrono::steady_clock::now();
+    for (int s = 0; s < steps; ++s) {
+        poolParallelFor(0, batches, threads, [&](int b0, int b1) {
+            for (int b = b0; b < b1; ++b) {
+                layer.batchDepth[b] = buildParticleBatch(layer, b, view.m, vertices.data() + (size_t)b * PARTICLE_BATCH_SIZE);
+            }
+        });
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    std::cout << "  vertex build (" << threads << " threads): " << ms / steps / millions << " ms per million per step\n";
+    return 0;
+}
+
+// ---------------------- Wind field & turbine farm ----------------------
+// The scene turbines first, then a regular layout (5 diameters along the mean wind,
+// 3 across) around them for large-farm runs
+void initTurbineFarm(TurbineFarm& farm, int count) {
+    count = std::max(count, TURBINE_COUNT);
+    farm.count = count;
+    farm.posX.resize(count); farm.posZ.resize(count);
+    farm.windU.assign(count, 0.0f); farm.windV.assign(count, 0.0f);
+    farm.yaw.assign(count, 0.0f);
+    farm.rotorAngle.resize(count); farm.rotorSpeed.assign(count, 0.0f);
+    farm.swayX.assign(count, 0.0f); farm.swayZ.assign(count, 0.0f);
+    farm.swayVelX.assign(count, 0.0f); farm.swayVelZ.assign(count, 0.0f);
+
+    for (int t = 0; t < TURBINE_COUNT; ++t) {
+        farm.posX[t] = turbineSites[t][0];
+        farm.posZ[t] = turbineSites[t][2];
+    }
+    const float diameter = 2.0f * turbineParams.bladeLength;
+    const int columns = (int)ceilf(sqrtf((float)count));
+    int placed = TURBINE_COUNT;
+    for (int cell = 0; placed < count; ++cell) {
+        float x = ((cell % columns) - columns / 2) * 5.0f * diameter;
+        float z = ((cell / columns) - columns / 2) * 3.0f * diameter;
+        if (fabsf(x) < 150.0f && fabsf(z) < 150.0f) continue; // keep the visible site clear
+        farm.posX[placed] = x;
+        farm.posZ[placed] = z;
+        placed++;
+    }
+    // Desynchronise rotors so identical inflow still looks natural
+    for (int t = 0; t < count; ++t) farm.rotorAngle[t] = counterUnit(counterRandom(TERRAIN_SEED, t, 0, 11), 0) * 120.0f;
+}
+
+// Grid covering the farm plus a wake length of margin, at most 512 points per side
+void initWindField(WindField& field, const TurbineFarm& farm) {
+    const float diameter = 2.0f * turbineParams.bladeLength;
+    const float margin = field.wakeLengthDiameters * diameter;
+    float minX = farm.posX[0], maxX = minX, minZ = farm.posZ[0], maxZ = minZ;
+    for (int t = 1; t < farm.count; ++t) {
+        minX = std::min(minX, farm.posX[t]); maxX = std::max(maxX, farm.posX[t]);
+        minZ = std::min(minZ, farm.posZ[t]); maxZ = std::max(maxZ, farm.posZ[t]);
+    }
+    minX -= margin; maxX += margin; minZ -= margin; maxZ += margin;
+    field.cellSize = std::max(diameter * 0.5f, std::max(maxX - minX, maxZ - minZ) / 511.0f);
+    field.originX = minX;
+    field.originZ = minZ;
+    field.width = (int)ceilf((maxX - minX) / field.cellSize) + 1;
+    field.height = (int)ceilf((maxZ - minZ) / field.cellSize) + 1;
+    field.u.assign((size_t)field.width * field.height, 0.0f);
+    field.v.assign((size_t)field.width * field.height, 0.0f);
+    field.rowWakes.assign(field.height, std::vector<int>());
+    field.wakeMinX.resize(farm.count);
+    field.wakeMaxX.resize(farm.count);
+    field.wakeDirection = 1e9f;
+    field.rowsPerFrame = field.height;
+    field.nextRow = 0;
+}
+
+// Bins every turbine's wake footprint (a cone along the mean wind) into the rows it crosses
+void rebuildWakeRows(WindField& field, const TurbineFarm& farm) {
+    const float diameter = 2.0f * turbineParams.bladeLength;
+    const float length = field.wakeLengthDiameters * diameter;
+    const float dir = field.meanDirection * (float)M_PI / 180.0f;
+    const float dx = -cosf(dir), dz = sinf(dir);
+    const float radius = diameter * 0.5f + field.wakeDecay * length;
+    for (std::vector<int>& row : field.rowWakes) row.clear();
+    for (int t = 0; t < farm.count; ++t) {
+        float x0 = farm.posX[t], z0 = farm.posZ[t];
+        float x1 = x0 + dx * length, z1 = z0 + dz * length;
+        field.wakeMinX[t] = std::min(x0, x1) - radius;
+        field.wakeMaxX[t] = std::max(x0, x1) + radius;
+        int r0 = std::max(0, (int)floorf((std::min(z0, z1) - radius - field.originZ) / field.cellSize));
+        int r1 = std::min(field.height - 1, (int)ceilf((std::max(z0, z1) + radius - field.originZ) / field.cellSize));
+        for (int r = r0; r <= r1; ++r) field.rowWakes[r].push_back(t);
+    }
+    field.wakeDirection = field.meanDirection;
+}
+
+// Smoothly interpolated lattice noise in [0, 1)
+float valueNoise(uint32_t seed, float x, float y) {
+    float fx = floorf(x), fy = floorf(y);
+    int ix = (int)fx, iy = (int)fy;
+    float tx = x - fx, ty = y - fy;
+    tx = tx * tx * (3.0f - 2.0f * tx);
+    ty = ty * ty * (3.0f - 2.0f * ty);
+    float a = valueNoiseLattice(seed, ix, iy), b = valueNoiseLattice(seed, ix + 1, iy);
+    float c = valueNoiseLattice(seed, ix, iy + 1), d = valueNoiseLattice(seed, ix + 1, iy + 1);
+    return (a + (b - a) * tx) + ((c + (d - c) * tx) - (a + (b - a) * tx)) * ty;
+}
+
+float valueNoiseLattice(uint32_t seed, int x, int y) {
+    return counterUnit(counterRandom(seed, (uint32_t)x, (uint32_t)y, 12), 0);
+}
+
+// Recomputes rows [rowBegin, rowEnd). Turbulence is frozen noise advected with the mean wind
+// (Taylor's hypothesis); overlapping wakes combine as the root sum of squared deficits.
+// Four columns at a time: a row shares its lattice rows, so lattice values are hashed once per
+// row (already blended along z) and gathered per column; smoothing, blending, the wake falloff
+// and the final combine run in simd4. updateWindRowsScalar is the per-cell reference.
+void updateWindRows(WindField& field, const TurbineFarm& farm, int rowBegin, int rowEnd) {
+    const float diameter = 2.0f * turbineParams.bladeLength;
+    const float length = field.wakeLengthDiameters * diameter;
+    const float dir = field.meanDirection * (float)M_PI / 180.0f;
+    const float dx = -cosf(dir), dz = sinf(dir);
+    const float meanU = dx * field.meanSpeed, meanV = dz * field.meanSpeed;
+    const float shiftX = meanU * field.advection * field.time, shiftZ = meanV * field.advection * field.time;
+    const float inductionDeficit = 1.0f - sqrtf(1.0f - field.thrustCoefficient);
+    const float gust = field.turbulence * field.meanSpeed;
+    const float invScale = 1.0f / field.turbulenceScale;
+    const float cell = field.cellSize;
+    const int width = field.width;
+    const int padded = (width + 3) & ~3;
+    std::vector<float> deficitSq(padded), gustU(padded), gustV(padded);
+    std::vector<float> lattice, lo(padded), hi(padded), frac(padded);
+
+    // Adds weight * (noise - 0.5) for every column of the row at world z
+    auto addNoiseRow = [&](uint32_t seed, float frequency, float weight, float z, float* acc) {
+        float ny = (z - shiftZ) * invScale * frequency;
+        float fy = floorf(ny);
+        int iy = (int)fy;
+        float ty = ny - fy;
+        ty = ty * ty * (3.0f - 2.0f * ty);
+        const float nx0 = (field.originX - shiftX) * invScale * frequency;
+        const float step = cell * invScale * frequency;
+        const int ix0 = (int)floorf(nx0);
+        const int ix1 = (int)floorf(nx0 + step * (padded - 1)) + 1;
+        // Filled on demand: the fine octave has more lattice points than columns
+        lattice.assign(ix1 - ix0 + 2, -1.0f);
+        auto latticeAt = [&](int i) {
+            if (lattice[i] < 0.0f) {
+                float a = valueNoiseLattice(seed, ix0 + i, iy), b = valueNoiseLattice(seed, ix0 + i, iy + 1);
+                lattice[i] = a + (b - a) * ty;
+            }
+            return lattice[i];
+        };
+        for (int c = 0; c < padded; ++c) {
+            float nx = nx0 + step * c;
+            float fx = floorf(nx);
+            int i = (int)fx - ix0;
+            lo[c] = latticeAt(i);
+            hi[c] = latticeAt(i + 1);
+            frac[c] = nx - fx;
+        }
+        const simd4 three = simdSplat(3.0f), two = simdSplat(2.0f), half = simdSplat(0.5f), w = simdSplat(weight);
+        for (int c = 0; c < padded; c += 4) {
+            simd4 t = simdLoad(&frac[c]);
+            simd4 smooth = simdMul(simdMul(t, t), simdSub(three, simdMul(two, t)));
+            simd4 a = simdLoad(&lo[c]);
+            simd4 n = simdMulAdd(simdSub(simdLoad(&hi[c]), a), smooth, a);
+            simdStore(acc + c, simdMulAdd(simdSub(n, half), w, simdLoad(acc + c)));
+        }
+    };
+
+    const float laneOffsets[4] = { 0.0f, cell, 2.0f * cell, 3.0f * cell };
+    const simd4 lanes = simdLoad(laneOffsets);
+    const simd4 vdx = simdSplat(dx), vdz = simdSplat(dz);
+    const simd4 vDiameter = simdSplat(diameter), vDecay2 = simdSplat(2.0f * field.wakeDecay);
+    const simd4 vNear = simdSplat(cell * 0.5f), vLength = simdSplat(length);
+    const simd4 vInduction = simdSplat(inductionDeficit), vHalf = simdSplat(0.5f);
+    const simd4 one = simdSplat(1.0f), zero = simdSplat(0.0f), vGust = simdSplat(gust);
+    const simd4 vMeanU = simdSplat(meanU), vMeanV = simdSplat(meanV);
+
+    for (int r = rowBegin; r < rowEnd; ++r) {
+        const float z = field.originZ + r * cell;
+        std::fill(deficitSq.begin(), deficitSq.end(), 0.0f);
+        std::fill(gustU.begin(), gustU.end(), 0.0f);
+        std::fill(gustV.begin(), gustV.end(), 0.0f);
+
+        // Wake falloff: geometry is evaluated exactly per lane, so blocks may spill past the
+        // footprint (into the padding at worst) without changing the result
+        for (int t : field.rowWakes[r]) {
+            int c0 = std::max(0, (int)floorf((field.wakeMinX[t] - field.originX) / cell)) & ~3;
+            int c1 = std::min(width - 1, (int)ceilf((field.wakeMaxX[t] - field.originX) / cell));
+            const simd4 rz = simdSplat(z - farm.posZ[t]);
+            for (int c = c0; c <= c1; c += 4) {
+                simd4 rx = simdAdd(simdSplat(field.originX + c * cell - farm.posX[t]), lanes);
+                simd4 down = simdMulAdd(rx, vdx, simdMul(rz, vdz));
+                simd4 across = simdSub(simdMul(rx, vdz), simdMul(rz, vdx));
+                simd4 grow = simdMax(simdMulAdd(vDecay2, down, vDiameter), vDiameter);
+                simd4 radius = simdMul(grow, vHalf);
+                // near < down <= length and |across| <= radius, as in the scalar kernel (the grid
+                // margin is exactly one wake length, so down == length does occur)
+                simd4 inside = simdMul(simdMul(simdLessMask(vNear, down), simdSub(one, simdLessMask(vLength, down))),
+                    simdSub(one, simdLessMask(simdMul(radius, radius), simdMul(across, across))));
+                simd4 ratio = simdDiv(vDiameter, grow);
+                simd4 deficit = simdMul(vInduction, simdMul(ratio, ratio));
+                simdStore(&deficitSq[c], simdMulAdd(simdMul(deficit, deficit), inside, simdLoad(&deficitSq[c])));
+            }
+        }
+
+        addNoiseRow(TERRAIN_SEED, 1.0f, 2.0f, z, gustU.data());
+        addNoiseRow(TERRAIN_SEED + 1, 3.1f, 1.0f, z, gustU.data());
+        addNoiseRow(TERRAIN_SEED + 2, 1.0f, 2.0f, z, gustV.data());
+        addNoiseRow(TERRAIN_SEED + 3, 3.1f, 1.0f, z, gustV.data());
+
+        // Rows are packed without padding, so the last partial block is finished in scalar
+        float* u = &field.u[(size_t)r * width];
+        float* v = &field.v[(size_t)r * width];
+        int c = 0;
+        for (; c + 4 <= width; c += 4) {
+            simd4 keep = simdMax(zero, simdSub(one, simdSqrt(simdLoad(&deficitSq[c]))));
+            simdStore(u + c, simdMul(simdMulAdd(vGust, simdLoad(&gustU[c]), vMeanU), keep));
+            simdStore(v + c, simdMul(simdMulAdd(vGust, simdLoad(&gustV[c]), vMeanV), keep));
+        }
+        for (; c < width; ++c) {
+            float keep = std::max(0.0f, 1.0f - sqrtf(deficitSq[c]));
+            u[c] = (meanU + gust * gustU[c]) * keep;
+            v[c] = (meanV + gust * gustV[c]) * keep;
+        }
+    }
+}
+
+void updateWindRowsScalar(WindField& field, const TurbineFarm& farm, int rowBegin, int rowEnd) {
+    const float diameter = 2.0f * turbineParams.bladeLength;
+    const float length = field.wakeLengthDiameters * diameter;
+    const float dir = field.meanDirection * (float)M_PI / 180.0f;
+    const float dx = -cosf(dir), dz = sinf(dir);
+    const float meanU = dx * field.meanSpeed, meanV = dz * field.meanSpeed;
+    const float shiftX = meanU * field.advection * field.time, shiftZ = meanV * field.advection * field.time;
+    const float inductionDeficit = 1.0f - sqrtf(1.0f - field.thrustCoefficient);
+    const float gust = field.turbulence * field.meanSpeed;
+    const float invScale = 1.0f / field.turbulenceScale;
+    std::vector<float> deficitSq(field.width);
+
+    for (int r = rowBegin; r < rowEnd; ++r) {
+        const float z = field.originZ + r * field.cellSize;
+        std::fill(deficitSq.begin(), deficitSq.end(), 0.0f);
+
+        for (int t : field.rowWakes[r]) {
+            int c0 = std::max(0, (int)floorf((field.wakeMinX[t] - field.originX) / field.cellSize));
+            int c1 = std::min(field.width - 1, (int)ceilf((field.wakeMaxX[t] - field.originX) / field.cellSize));
+            for (int c = c0; c <= c1; ++c) {
+                float rx = field.originX + c * field.cellSize - farm.posX[t];
+                float rz = z - farm.posZ[t];
+                float down = rx * dx + rz * dz;
+                if (down <= field.cellSize * 0.5f || down > length) continue;
+                float lateral = fabsf(rx * dz - rz * dx);
+                float grow = diameter + 2.0f * field.wakeDecay * down;
+                if (lateral > grow * 0.5f) continue;
+                float deficit = inductionDeficit * (diameter / grow) * (diameter / grow);
+                deficitSq[c] += deficit * deficit;
+            }
+        }
+
+        float* u = &field.u[(size_t)r * field.width];
+        float* v = &field.v[(size_t)r * field.width];
+        for (int c = 0; c < field.width; ++c) {
+            float x = field.originX + c * field.cellSize;
+            float nx = (x - shiftX) * invScale, nz = (z - shiftZ) * invScale;
+            float gu = (valueNoise(TERRAIN_SEED, nx, nz) - 0.5f) * 2.0f + (valueNoise(TERRAIN_SEED + 1, nx * 3.1f, nz * 3.1f) - 0.5f);
+            float gv = (valueNoise(TERRAIN_SEED + 2, nx, nz) - 0.5f) * 2.0f + (valueNoise(TERRAIN_SEED + 3, nx * 3.1f, nz * 3.1f) - 0.5f);
+            float keep = std::max(0.0f, 1.0f - sqrtf(deficitSq[c]));
+            u[c] = (meanU + gust * gu) * keep;
+            v[c] = (meanV + gust * gv) * keep;
+        }
+    }
+}
+
+// Refreshes the next slice of rows in parallel and resizes the slice to fit the budget
+void updateWindField(WindField& field, const TurbineFarm& farm, float dt, int threads) {
+    auto start = std::chrono::steady_clock::now();
+    field.time += dt;
+    if (fabsf(field.meanDirection - field.wakeDirection) > 0.5f) rebuildWakeRows(field, farm);
+
+    int rows = std::max(1, std::min(field.rowsPerFrame, field.height));
+    int first = field.nextRow;
+    int last = std::min(field.height, first + rows);
+
+    // Each chunk times its own rows; the slowest chunk is the kernel's critical path, which
+    // leaves wake-up and scheduling overhead out of the row budget
+    std::mutex timingMutex;
+    float sliceMs = 0.0f;
+    auto work = [&](int r0, int r1) {
+        auto chunkStart = std::chrono::steady_clock::now();
+        updateWindRows(field, farm, r0, r1);
+        float ms = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - chunkStart).count();
+        std::lock_guard<std::mutex> lock(timingMutex);
+        sliceMs = std::max(sliceMs, ms);
+    };
+    poolParallelFor(first, last, threads, work);
+    field.kernelMs = sliceMs;
+    if (last - first < rows) { // wrap around
+        sliceMs = 0.0f;
+        poolParallelFor(0, rows - (last - first), threads, work);
+        field.kernelMs += sliceMs;
+    }
+    field.nextRow = (first + rows) % field.height;
+
+    field.fieldMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (field.kernelMs > 0.0f) {
+        field.rowsPerFrame = std::max(1, std::min(field.height, (int)(rows * field.budgetMs * 0.9f / field.kernelMs)));
+    }
+}
+
+void sampleWind(const WindField& field, float x, float z, float& u, float& v) {
+    float gx = (x - field.originX) / field.cellSize;
+    float gz = (z - field.originZ) / field.cellSize;
+    gx = std::max(0.0f, std::min((float)field.width - 1.001f, gx));
+    gz = std::max(0.0f, std::min((float)field.height - 1.001f, gz));
+    int c = (int)gx, r = (int)gz;
+    float tx = gx - c, tz = gz - r;
+    size_t i00 = (size_t)r * field.width + c, i01 = i00 + field.width;
+    u = (field.u[i00] * (1 - tx) + field.u[i00 + 1] * tx) * (1 - tz) + (field.u[i01] * (1 - tx) + field.u[i01 + 1] * tx) * tz;
+    v = (field.v[i00] * (1 - tx) + field.v[i00 + 1] * tx) * (1 - tz) + (field.v[i01] * (1 - tx) + field.v[i01 + 1] * tx) * tz;
+}
+
+// Samples local wind, then in 4-wide SIMD: rotor speed relaxes toward gain * |wind| and the
+// hub sway is a damped spring loaded by drag. Yaw tracking (atan2) and wraps stay scalar.
+void updateTurbineRange(TurbineFarm& farm, const WindField& field, int begin, int end, float dt) {
+    for (int t = begin; t < end; ++t) sampleWind(field, farm.posX[t], farm.posZ[t], farm.windU[t], farm.windV[t]);
+
+    float* wu = farm.windU.data(); float* wv = farm.windV.data();
+    float* angle = farm.rotorAngle.data(); float* speed = farm.rotorSpeed.data();
+    float* sx = farm.swayX.data(); float* sz = farm.swayZ.data();
+    float* vx = farm.swayVelX.data(); float* vz = farm.swayVelZ.data();
+    const float response = std::min(1.0f, farm.rotorResponse * dt);
+
+    const simd4 step = simdSplat(dt), gain = simdSplat(farm.rotorGain), resp = simdSplat(response);
+    const simd4 load = simdSplat(farm.swayLoad), stiffness = simdSplat(farm.swayStiffness), damping = simdSplat(farm.swayDamping);
+    int t = begin;
+    for (; t + 4 <= end; t += 4) {
+        simd4 u = simdLoad(wu + t), v = simdLoad(wv + t);
+        simd4 mag = simdSqrt(simdMulAdd(u, u, simdMul(v, v)));
+
+        simd4 rs = simdLoad(speed + t);
+        rs = simdMulAdd(simdSub(simdMul(mag, gain), rs), resp, rs);
+        simdStore(speed + t, rs);
+        simdStore(angle + t, simdMulAdd(rs, step, simdLoad(angle + t)));
+
+        simd4 px = simdLoad(sx + t), pz = simdLoad(sz + t);
+        simd4 qx = simdLoad(vx + t), qz = simdLoad(vz + t);
+        simd4 ax = simdSub(simdSub(simdMul(simdMul(load, mag), u), simdMul(stiffness, px)), simdMul(damping, qx));
+        simd4 az = simdSub(simdSub(simdMul(simdMul(load, mag), v), simdMul(stiffness, pz)), simdMul(damping, qz));
+        qx = simdMulAdd(ax, step, qx);
+        qz = simdMulAdd(az, step, qz);
+        simdStore(vx + t, qx); simdStore(vz + t, qz);
+        simdStore(sx + t, simdMulAdd(qx, step, px));
+        simdStore(sz + t, simdMulAdd(qz, step, pz));
+    }
+    for (; t < end; ++t) {
+        float mag = sqrtf(wu[t] * wu[t] + wv[t] * wv[t]);
+        speed[t] += (mag * farm.rotorGain - speed[t]) * response;
+        angle[t] += speed[t] * dt;
+        vx[t] += (farm.swayLoad * mag * wu[t] - farm.swayStiffness * sx[t] - farm.swayDamping * vx[t]) * dt;
+        vz[t] += (farm.swayLoad * mag * wv[t] - farm.swayStiffness * sz[t] - farm.swayDamping * vz[t]) * dt;
+        sx[t] += vx[t] * dt;
+        sz[t] += vz[t] * dt;
+    }
+
+    const float maxYaw = farm.yawRate * dt;
+    for (t = begin; t < end; ++t) {
+        if (angle[t] >= 360.0f) angle[t] -= 360.0f;
+        // Face upwind: rotor axis (+X in nacelle space) against the local wind
+        float target = atan2f(wv[t], -wu[t]) * 180.0f / (float)M_PI;
+        float error = target - farm.yaw[t];
+        error -= 360.0f * floorf((error + 180.0f) / 360.0f);
+        farm.yaw[t] += std::max(-maxYaw, std::min(maxYaw, error));
+    }
+}
+
+void updateTurbineFarm(TurbineFarm& farm, const WindField& field, float dt, int threads) {
+    auto start = std::chrono::steady_clock::now();
+    // Split on groups of four so every chunk but the last runs fully in SIMD
+    int groups = (farm.count + 3) / 4;
+    poolParallelFor(0, groups, threads, [&](int g0, int g1) {
+        updateTurbineRange(farm, field, g0 * 4, std::min(farm.count, g1 * 4), dt);
+    });
+    farm.updateMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Visual lean of the mast that puts the hub at the sway displacement
+float turbineLeanDegrees(float swayX, float swayZ, float height) {
+    return atanf(sqrtf(swayX * swayX + swayZ * swayZ) / height) * 180.0f / (float)M_PI;
+}
+
+// 10k-turbine farm: full-grid cost, budgeted per-frame cost and turbine update, 1 vs N threads
+int runWindBenchmark(int threads) {
+    threads = std::max(1, threads);
+    const int turbines = 10000;
+    const int steps = 60;
+    std::cout << "Wind benchmark (" << turbines << " turbines, " << steps << " steps)\n";
+
+    // Row kernel alone, one thread: per-cell scalar reference against the simd4 version
+    {
+        TurbineFarm farm;
+        WindField scalar, simd;
+        initTurbineFarm(farm, turbines);
+        initWindField(scalar, farm);
+        scalar.meanSpeed = 2.0f;
+        scalar.time = 3.0f;
+        rebuildWakeRows(scalar, farm);
+        simd = scalar;
+        const int passes = 5;
+        auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < passes; ++i) updateWindRowsScalar(scalar, farm, 0, scalar.height);
+        auto t1 = std::chrono::steady_clock::now();
+        for (int i = 0; i < passes; ++i) updateWindRows(simd, farm, 0, simd.height);
+        auto t2 = std::chrono::steady_clock::now();
+        float diff = 0.0f;
+        for (size_t i = 0; i < scalar.u.size(); ++i) {
+            diff = std::max(diff, std::max(fabsf(scalar.u[i] - simd.u[i]), fabsf(scalar.v[i] - simd.v[i])));
+        }
+        double scalarMs = std::chrono::duration<double, std::milli>(t1 - t0).count() / passes;
+        double simdMs = std::chrono::duration<double, std::milli>(t2 - t1).count() / passes;
+        std::cout << "  full field kernel, 1 thread: scalar " << scalarMs << " ms | simd " << simdMs
+            << " ms | speedup " << scalarMs / simdMs << "x | max diff " << diff << "\n";
+    }
+
+    for (int pass = 0; pass < 2; ++pass) {
+        int threadCount = pass == 0 ? 1 : threads;
+        TurbineFarm farm;
+        WindField field;
+        initTurbineFarm(farm, turbines);
+        initWindField(field, farm);
+        field.meanSpeed = 2.0f;
+
+        // Full refresh every step
+        auto t0 = std::chrono::steady_clock::now();
+        for (int s = 0; s < steps; ++s) {
+            field.meanDirection = sinf(s * 0.016f * 0.3f) * 15.0f;
+            field.rowsPerFrame = field.height;
+            updateWindField(field, farm, 0.016f, threadCount);
+        }
+        double fullMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count() / steps;
+
+        // Budgeted refresh plus turbine update, as the render loop runs it
+        double fieldMs = 0.0, kernelMs = 0.0, turbineMs = 0.0, worstMs = 0.0;
+        for (int s = 0; s < steps; ++s) {
+            field.meanDirection = sinf(s * 0.016f * 0.3f) * 15.0f;
+            auto a = std::chrono::steady_clock::now();
+            updateWindField(field, farm, 0.016f, threadCount);
+            auto b = std::chrono::steady_clock::now();
+            updateTurbineFarm(farm, field, 0.016f, threadCount);
+            auto c = std::chrono::steady_clock::now();
+            double f = std::chrono::duration<double, std::milli>(b - a).count();
+            double t = std::chrono::duration<double, std::milli>(c - b).count();
+            fieldMs += f; kernelMs += field.kernelMs; turbineMs += t;
+            worstMs = std::max(worstMs, f + t);
+        }
+        std::cout << "  " << threadCount << " thread(s), grid " << field.width << "x" << field.height
+            << ": full field " << fullMs << " ms"
+            << " | budgeted field " << fieldMs / steps << " ms (kernel " << kernelMs / steps << " ms, "
+            << field.rowsPerFrame << " rows/frame, budget "
+            << field.budgetMs << " ms)"
+            << " | turbines " << turbineMs / steps << " ms"
+            << " | worst frame " << worstMs << " ms\n";
+    }
+    return 0;
+}